@@ -7,6 +7,12 @@
 #include <string>
 #include <queue>
 #include <stack>
+#include <utility>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <cassert>
 
 template<typename var_t>
 struct PairT
@@ -135,11 +141,166 @@ void printDerivationTree
 
 
 
-template<class SlpT>
+/*!
+ * Array of nodes aligned to a cache line, to be used as the container of the paths of the SLP traversals.
+ * Its capacity is the length of the longest path seen so far, hence a path reused across calls,
+ * e.g., through SlpTraversalContext, stops allocating once it has been as deep as the grammar.
+ */
+template<class T>
+class PathArray
+{
+  static_assert(std::is_trivially_destructible<T>::value, "PathArray does not destroy its elements");
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using reference = T &;
+  using const_reference = const T &;
+
+  static constexpr size_t kAlign = 64;
+  static constexpr size_t kInitCapacity = 64;
+
+  PathArray() {
+    reserve(kInitCapacity);
+  }
+
+  PathArray(const PathArray & other) {
+    reserve(std::max(other.capacity_, kInitCapacity));
+    *this = other;
+  }
+
+  PathArray(PathArray && other) noexcept {
+    swap(other);
+  }
+
+  ~PathArray() {
+    if (data_ != nullptr) {
+      ::operator delete[](data_, std::align_val_t(kAlign));
+    }
+  }
+
+  PathArray & operator=(const PathArray & other) {
+    if (this != &other) {
+      reserve(other.size_);
+      std::uninitialized_copy(other.data_, other.data_ + other.size_, data_);
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  PathArray & operator=(PathArray && other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  void swap(PathArray & other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+  }
+
+  void reserve(const size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    T * data = static_cast<T *>(::operator new[](capacity * sizeof(T), std::align_val_t(kAlign)));
+    if (data_ != nullptr) {
+      std::uninitialized_copy(data_, data_ + size_, data);
+      ::operator delete[](data_, std::align_val_t(kAlign));
+    }
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  void push_back(const T & x) {
+    if (size_ == capacity_) {
+      reserve(2 * capacity_);
+    }
+    new (data_ + size_++) T(x);
+  }
+
+  void pop_back() {
+    assert(size_ > 0);
+    --size_;
+  }
+
+  T & back() {
+    return data_[size_ - 1];
+  }
+
+  const T & back() const {
+    return data_[size_ - 1];
+  }
+
+  const T & operator[](const size_t i) const {
+    return data_[i];
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void clear() {
+    size_ = 0;
+  }
+
+private:
+  T * data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+
+/*!
+ * Path of nodes from the root, as built by getPrefixPath, that can be emptied keeping its memory.
+ */
+template<class nodeT>
+class SlpPath : public std::stack<nodeT, PathArray<nodeT>>
+{
+public:
+  void clear() {
+    this->c.clear();
+  }
+};
+
+
+/*!
+ * Paths reused by the traversals of the calling thread, so that they do not allocate on every call.
+ */
+template<class nodeT>
+struct SlpTraversalContext
+{
+  SlpPath<nodeT> path1, path2, path3;
+
+  static SlpTraversalContext & local() {
+    thread_local SlpTraversalContext context;
+    return context;
+  }
+};
+
+
+/*!
+ * Number of nodes pushed on paths by the traversals of the calling thread, to measure their work.
+ */
+inline uint64_t & slpVisitedNodes() {
+  thread_local uint64_t visited = 0;
+  return visited;
+}
+
+
+template<class SlpT, class ContainerT>
 void getPrefixPath
 (
  const SlpT & slp,
- std::stack<typename SlpT::nodeT> & path,
+ std::stack<typename SlpT::nodeT, ContainerT> & path,
  uint64_t pos
 ) {
   if (pos >= slp.getLen()) {
@@ -152,6 +313,7 @@ void getPrefixPath
   while (pos) {
     path.push(slp.getChildNodeForPos(path.top(), pos)); // pos is modified to relative pos in a node
   }
+  slpVisitedNodes() += path.size();
 }
 
 
@@ -159,11 +321,11 @@ void getPrefixPath
  * modify the stack 'path' to point the highest node that is adjacent to the node path.top()
  * return false when such a node does not exist
  */
-template<class SlpT>
+template<class SlpT, class ContainerT>
 bool proceedPrefixPath
 (
  const SlpT & slp,
- std::stack<typename SlpT::nodeT> & path
+ std::stack<typename SlpT::nodeT, ContainerT> & path
  ) {
   if (path.size() <= 1) {
     return false;
@@ -173,6 +335,7 @@ bool proceedPrefixPath
     n = path.top();
     path.pop();
   } while (path.size() > 1 and std::get<2>(n) == 1);
+  ++slpVisitedNodes();
   if (path.size() > 1) {
     path.push(slp.getChildNode(path.top(), 1));
   } else { // add (std::get<2>(n) + 1)th (0base) child of root
@@ -186,19 +349,167 @@ bool proceedPrefixPath
 }
 
 
-template<class SlpT>
+/*!
+ * modify the stack 'path' to point the highest node that is adjacent to the left of the node path.top()
+ * return false when such a node does not exist
+ */
+template<class SlpT, class ContainerT>
+bool retreatPrefixPath
+(
+ const SlpT & slp,
+ std::stack<typename SlpT::nodeT, ContainerT> & path
+ ) {
+  if (path.size() <= 1) {
+    return false;
+  }
+  typename SlpT::nodeT n;
+  do {
+    n = path.top();
+    path.pop();
+  } while (path.size() > 1 and std::get<2>(n) == 0);
+  ++slpVisitedNodes();
+  if (path.size() > 1) {
+    path.push(slp.getChildNode(path.top(), 0));
+  } else { // add (std::get<2>(n) - 1)th (0base) child of root
+    if (std::get<2>(n) > 0) {
+      path.push(slp.getChildNode_Root(std::get<2>(n) - 1));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+template<class SlpT, class ContainerT>
 void descentPrefixPath
 (
  const SlpT & slp,
- std::stack<typename SlpT::nodeT> & path,
+ std::stack<typename SlpT::nodeT, ContainerT> & path,
  const uint64_t len
  ) {
   auto n = (path.size() == 1) ? slp.getChildNode_Root(0) : slp.getChildNode(path.top(), 0);
   path.push(n);
+  uint64_t visited = 1;
   while (std::get<0>(n) > len) {
     n = slp.getChildNode(path.top(), 0);
     path.push(n);
+    ++visited;
   }
+  slpVisitedNodes() += visited;
+}
+
+
+template<class SlpT>
+auto directNodeLcp
+(
+ const SlpT & slp,
+ const typename SlpT::nodeT & n1,
+ const typename SlpT::nodeT & n2,
+ int
+ ) -> decltype(slp.hotLcp(n1, n2)) {
+  return slp.hotLcp(n1, n2);
+}
+
+
+template<class SlpT>
+uint64_t directNodeLcp
+(
+ const SlpT &,
+ const typename SlpT::nodeT &,
+ const typename SlpT::nodeT &,
+ long
+ ) {
+  return UINT64_MAX;
+}
+
+
+/*!
+ * lcp of the expansions of the nodes n1 and n2 of the same length, if the slp can compute it without
+ * descending (see SelfShapedSlp::hotLcp); UINT64_MAX otherwise.
+ */
+template<class SlpT>
+uint64_t directNodeLcp
+(
+ const SlpT & slp,
+ const typename SlpT::nodeT & n1,
+ const typename SlpT::nodeT & n2
+ ) {
+  return directNodeLcp(slp, n1, n2, 0);
+}
+
+
+template<class SlpT>
+auto fingerprintLce
+(
+ const SlpT & slp,
+ const uint64_t p1,
+ const uint64_t p2,
+ const uint64_t upperbound,
+ int
+ ) -> decltype(slp.lceByFingerprint(p1, p2, upperbound)) {
+  return slp.lceByFingerprint(p1, p2, upperbound);
+}
+
+
+template<class SlpT>
+uint64_t fingerprintLce
+(
+ const SlpT &,
+ const uint64_t,
+ const uint64_t,
+ const uint64_t,
+ long
+ ) {
+  return UINT64_MAX;
+}
+
+
+/*!
+ * lce of T[p1..] and T[p2..] up to upperbound, if the slp can compute it with fingerprints
+ * (see SelfShapedSlp::makeFingerprints); UINT64_MAX otherwise.
+ */
+template<class SlpT>
+uint64_t fingerprintLce
+(
+ const SlpT & slp,
+ const uint64_t p1,
+ const uint64_t p2,
+ const uint64_t upperbound
+ ) {
+  return fingerprintLce(slp, p1, p2, upperbound, 0);
+}
+
+
+template<class SlpT>
+auto hasFingerprints
+(
+ const SlpT & slp,
+ int
+ ) -> decltype(slp.hasFingerprints()) {
+  return slp.hasFingerprints();
+}
+
+
+template<class SlpT>
+bool hasFingerprints
+(
+ const SlpT &,
+ long
+ ) {
+  return false;
+}
+
+
+/*!
+ * Whether fingerprintLce can compute LCEs on the slp.
+ */
+template<class SlpT>
+bool hasFingerprints
+(
+ const SlpT & slp
+ ) {
+  return hasFingerprints(slp, 0);
 }
 
 
@@ -209,7 +520,11 @@ uint64_t lceToR
  const uint64_t p1,
  const uint64_t p2
 ) {
-  std::stack<typename SlpT::nodeT> path1, path2;
+  auto & context = SlpTraversalContext<typename SlpT::nodeT>::local();
+  auto & path1 = context.path1;
+  auto & path2 = context.path2;
+  path1.clear();
+  path2.clear();
 
   getPrefixPath(slp, path1, p1);
   getPrefixPath(slp, path2, p2);
@@ -238,6 +553,11 @@ uint64_t lceToR
         break;
       }
     } else if (std::get<0>(n1) > 1) { // mismatch with non-terminal
+      const uint64_t lcp = directNodeLcp(slp, n1, n2);
+      if (lcp < std::get<0>(n1)) { // lce ends with mismatch in the expansions
+        l += lcp;
+        break;
+      }
       descentPrefixPath(slp, path1, std::get<0>(n1) - 1);
       descentPrefixPath(slp, path2, std::get<0>(n1) - 1);
     } else { // lce ends with mismatch char
@@ -247,19 +567,18 @@ uint64_t lceToR
   return l;
 }
 
-template<class SlpT>
+/*!
+ * lceToRBounded on prebuilt paths, e.g., paths obtained with getPrefixPath or kept by a cursor across queries.
+ * The paths are consumed.
+ */
+template<class SlpT, class ContainerT>
 uint64_t lceToRBounded
 (
  const SlpT & slp,
- const uint64_t p1,
- const uint64_t p2,
+ std::stack<typename SlpT::nodeT, ContainerT> & path1,
+ std::stack<typename SlpT::nodeT, ContainerT> & path2,
  const uint64_t upperbound
 ) {
-  std::stack<typename SlpT::nodeT> path1, path2;
-
-  getPrefixPath(slp, path1, p1);
-  getPrefixPath(slp, path2, p2);
-
   uint64_t l = 0;
   while (true) {
     auto n1 = path1.top();
@@ -268,11 +587,9 @@ uint64_t lceToRBounded
       if (std::get<0>(n1) > std::get<0>(n2)) {
         descentPrefixPath(slp, path1, std::get<0>(n2));
         n1 = path1.top();
-        // std::cout << "descent n1: " << std::get<0>(n1) << ", " << std::get<1>(n1) << ", " << std::get<2>(n1) << std::endl;
       } else {
         descentPrefixPath(slp, path2, std::get<0>(n1));
         n2 = path2.top();
-        // std::cout << "descent n2: " << std::get<0>(n2) << ", " << std::get<1>(n2) << ", " << std::get<2>(n2) << std::endl;
       }
     }
     if (std::get<1>(n1) == std::get<1>(n2)) { // match
@@ -285,6 +602,11 @@ uint64_t lceToRBounded
         break;
       }
     } else if (std::get<0>(n1) > 1) { // mismatch with non-terminal
+      const uint64_t lcp = directNodeLcp(slp, n1, n2);
+      if (lcp < std::get<0>(n1)) { // lce ends with mismatch in the expansions
+        l += lcp;
+        break;
+      }
       descentPrefixPath(slp, path1, std::get<0>(n1) - 1);
       descentPrefixPath(slp, path2, std::get<0>(n1) - 1);
     } else { // lce ends with mismatch char
@@ -294,6 +616,148 @@ uint64_t lceToRBounded
   return l;
 }
 
+template<class SlpT>
+uint64_t lceToRBounded
+(
+ const SlpT & slp,
+ const uint64_t p1,
+ const uint64_t p2,
+ const uint64_t upperbound
+) {
+  auto & context = SlpTraversalContext<typename SlpT::nodeT>::local();
+  auto & path1 = context.path1;
+  auto & path2 = context.path2;
+  path1.clear();
+  path2.clear();
+
+  getPrefixPath(slp, path1, p1);
+  getPrefixPath(slp, path2, p2);
+
+  return lceToRBounded(slp, path1, path2, upperbound);
+}
+
+
+/*!
+ * Computes lceToRBounded of both path1 and path2 against common with a single traversal of common.
+ * The candidates are kept at the same offset of common, and each one of them stops on its own
+ * when it mismatches, reaches upperbound, or reaches the end of the text. Empty paths give 0.
+ * The paths are consumed.
+ */
+template<class SlpT, class ContainerT>
+std::pair<uint64_t, uint64_t> lce2ToRBounded
+(
+ const SlpT & slp,
+ std::stack<typename SlpT::nodeT, ContainerT> & path1,
+ std::stack<typename SlpT::nodeT, ContainerT> & path2,
+ std::stack<typename SlpT::nodeT, ContainerT> & common,
+ const uint64_t upperbound
+) {
+  std::stack<typename SlpT::nodeT, ContainerT> * paths[2] = {&path1, &path2};
+  bool active[2] = {!path1.empty(), !path2.empty()};
+  uint64_t lens[2] = {0, 0};
+  if (common.empty()) {
+    return {0, 0};
+  }
+
+  uint64_t l = 0;
+  while (active[0] or active[1]) {
+    // descend until the top nodes of all the active paths have the same length
+    uint64_t len;
+    while (true) {
+      len = std::get<0>(common.top());
+      for (int k = 0; k < 2; ++k) {
+        if (active[k]) {
+          len = std::min(len, std::get<0>(paths[k]->top()));
+        }
+      }
+      bool aligned = true;
+      if (std::get<0>(common.top()) > len) {
+        descentPrefixPath(slp, common, len);
+        aligned = false;
+      }
+      for (int k = 0; k < 2; ++k) {
+        if (active[k] and std::get<0>(paths[k]->top()) > len) {
+          descentPrefixPath(slp, *paths[k], len);
+          aligned = false;
+        }
+      }
+      if (aligned) {
+        break;
+      }
+    }
+
+    const auto id = std::get<1>(common.top());
+    bool mismatch = false;
+    for (int k = 0; k < 2; ++k) {
+      if (not active[k] or std::get<1>(paths[k]->top()) == id) {
+        continue;
+      }
+      const uint64_t lcp = (len > 1) ? directNodeLcp(slp, paths[k]->top(), common.top()) : UINT64_MAX;
+      if (lcp < len) { // lce ends with mismatch in the expansions
+        lens[k] = l + lcp;
+        active[k] = false;
+      } else {
+        mismatch = true;
+      }
+    }
+    if (not (active[0] or active[1])) {
+      break;
+    }
+    if (mismatch and len > 1) { // mismatch with non-terminal: the matching candidate descends as well
+      descentPrefixPath(slp, common, len - 1);
+      for (int k = 0; k < 2; ++k) {
+        if (active[k]) {
+          descentPrefixPath(slp, *paths[k], len - 1);
+        }
+      }
+      continue;
+    }
+
+    l += len;
+    for (int k = 0; k < 2; ++k) {
+      if (not active[k]) {
+        continue;
+      }
+      if (std::get<1>(paths[k]->top()) != id) { // lce ends with mismatch char
+        active[k] = false;
+        continue;
+      }
+      lens[k] = l;
+      if (l >= upperbound or not proceedPrefixPath(slp, *paths[k])) {
+        active[k] = false;
+      }
+    }
+    if ((active[0] or active[1]) and not proceedPrefixPath(slp, common)) {
+      break;
+    }
+  }
+  return {lens[0], lens[1]};
+}
+
+template<class SlpT>
+std::pair<uint64_t, uint64_t> lce2ToRBounded
+(
+ const SlpT & slp,
+ const uint64_t p1,
+ const uint64_t p2,
+ const uint64_t common,
+ const uint64_t upperbound
+) {
+  auto & context = SlpTraversalContext<typename SlpT::nodeT>::local();
+  auto & path1 = context.path1;
+  auto & path2 = context.path2;
+  auto & pathc = context.path3;
+  path1.clear();
+  path2.clear();
+  pathc.clear();
+
+  getPrefixPath(slp, path1, p1);
+  getPrefixPath(slp, path2, p2);
+  getPrefixPath(slp, pathc, common);
+
+  return lce2ToRBounded(slp, path1, path2, pathc, upperbound);
+}
+
 
 template<class SlpT>
 uint64_t lceToR_Naive
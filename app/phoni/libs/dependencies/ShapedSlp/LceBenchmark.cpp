@@ -49,6 +49,23 @@ uint64_t naiveLceToR
 }
 
 
+//// lceToR with the deque-backed paths allocated on every call, as it was before SlpTraversalContext
+template<class SlpT>
+uint64_t dequeLceToR
+(
+ const SlpT & slp,
+ const uint64_t p1,
+ const uint64_t p2
+) {
+  std::stack<typename SlpT::nodeT> path1, path2;
+
+  getPrefixPath(slp, path1, p1);
+  getPrefixPath(slp, path2, p2);
+
+  return lceToRBounded(slp, path1, path2, UINT64_MAX);
+}
+
+
 template<class SlpT>
 void measure
 (
@@ -108,13 +125,13 @@ void measure
       for (uint64_t i = 0; i < numItr; ++i) {
         const uint64_t p1 = rndUniform(mt);
         const uint64_t p2 = rndUniform(mt);
-        checksum1 += lceToR(slp, p1, p2);
+        checksum1 += dequeLceToR(slp, p1, p2);
       }
       stop = timer::now();
       times[loop] = (double)duration_cast<microseconds>(stop-start).count() / numItr;
     }
     std::sort(times.begin(), times.end());
-    cout << "time to naive lce queries (micro sec per query): " << times[numLoop / 2] << endl;
+    cout << "time to lce queries with deque paths (micro sec per query): " << times[numLoop / 2] << endl;
   }
 
   cout << "averagec LCE length = " << checksum0 / (numItr * numLoop) << endl;
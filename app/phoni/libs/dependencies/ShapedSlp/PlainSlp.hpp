@@ -189,6 +189,15 @@ public:
   }
 
 
+  char getLeafChar
+  (
+   const nodeT & node
+   ) const {
+    assert(std::get<0>(node) == 1); // len == 1
+    return getChar(std::get<1>(node));
+  }
+
+
   nodeT getRootNode() const {
     return std::forward_as_tuple(getLen(), 0, 0);
   }
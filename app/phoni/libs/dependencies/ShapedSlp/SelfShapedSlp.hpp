@@ -7,6 +7,9 @@
 #include <stdint.h> // include uint64_t etc.
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <random>
+#include <algorithm>
 #include "Common.hpp"
 #include "NaiveSlp.hpp"
 #include "RecSplit.hpp"
@@ -37,6 +40,14 @@ private:
   //// parameter of RecSplit
   static constexpr size_t kBucketSize = 100;
   static constexpr size_t kLeaf = 8;
+  //// expansion lengths smaller than kDirectLen are hashed by table lookup
+  static constexpr uint64_t kDirectLen = 4096;
+  //// parameters of the hot cache: shorter variables are not cached, and the default profile has kHotProfileSize positions
+  static constexpr uint64_t kMinHotLen = 16;
+  static constexpr uint64_t kHotProfileSize = 1 << 16;
+  static constexpr uint64_t kNotHot = UINT64_MAX;
+  //// modulus of the Karp-Rabin fingerprints, the Mersenne prime 2^61 - 1
+  static constexpr uint64_t kKrPrime = (1ULL << 61) - 1;
 
   std::vector<char> alph_;
   sdsl::sd_vector<> seqSBV_;
@@ -49,6 +60,20 @@ private:
   DacT vlc_;
   BalDacT bal_;
   sux::function::RecSplit<kLeaf> * rs_; // minimal perfect hash: from "expansion lengths" to IDs for them
+  std::vector<var_t> directHash_; // values of rs_ for the small expansion lengths, not serialized
+  //// expansions of the hot variables (see makeHotCache), not serialized
+  uint64_t hotWidth_ = 0; // bits per character, a power of 2 so that no character spans two words
+  std::vector<uint64_t> hotBits_; // marks the ids of the hot variables
+  std::vector<uint64_t> hotRank_; // number of hot variables before each word of hotBits_
+  std::vector<uint64_t> hotStart_; // first word in hotData_ of the expansion of each hot variable
+  std::vector<uint64_t> hotData_; // expansions as packed indexes in alph_
+  //// Karp-Rabin fingerprints (see makeFingerprints), not serialized
+  uint64_t krBase_ = 0;
+  uint64_t krBaseInv_ = 0; // inverse of krBase_ modulo kKrPrime
+  std::vector<uint64_t> krVar_; // fingerprint of the expansion of each variable, by id: 8 bytes per rule
+  std::vector<uint64_t> krPow_; // krBase_ to the power of each expansion length, by hashLen of the length
+  std::vector<uint64_t> krSeq_; // fingerprint of the text before each variable of the top-level sequence, and of the whole text
+  std::vector<uint64_t> krSeqPow_; // krBase_ to the power of the text position of each variable of the top-level sequence
 
 
 public:
@@ -119,18 +144,26 @@ public:
     assert(pos < varLen);
     // std::cout << "pos = " << pos << ", varLen = " << varLen << ", slpOffset = " << slpOffset << std::endl;
 
-    if (varLen == 1) {
-      return alph_[slpOffset];
-    }
-    const uint64_t h = hashLen(varLen);
-    const uint64_t slpId = slpDivSel_(h + 1) + slpOffset;
-    const uint64_t balPos = h + balBvRank_(slpId - h);
-    const uint64_t leftLen = decLeftVarLen(varLen, bal_[balPos]);
-    if (pos < leftLen) {
-      return charAt(pos, leftLen, vlc_[2 * slpId]);
-    } else {
-      return charAt(pos - leftLen, varLen - leftLen, vlc_[2 * slpId + 1]);
+    uint64_t p = pos;
+    uint64_t len = varLen;
+    var_t offset = slpOffset;
+    while (len > 1) {
+      uint64_t slpId;
+      const uint64_t leftLen = getLeftLen(len, offset, slpId);
+      const uint64_t slot = hotSlot(slpId);
+      if (slot != kNotHot) {
+        return alph_[hotCode(slot, p)];
+      }
+      if (p < leftLen) {
+        len = leftLen;
+        offset = vlc_[2 * slpId];
+      } else {
+        p -= leftLen;
+        len -= leftLen;
+        offset = vlc_[2 * slpId + 1];
+      }
     }
+    return alph_[offset];
   }
 
 
@@ -168,22 +201,36 @@ public:
     // std::cout << "pos = " << pos << ", len = " << len << ", varLen = " << varLen << ", slpOffset = " << slpOffset << std::endl;
     assert(pos < varLen);
 
-    if (varLen == 1) {
-      *str = alph_[slpOffset];
-      return;
-    }
-    const uint64_t h = hashLen(varLen);
-    const uint64_t slpId = slpDivSel_(h + 1) + slpOffset;
-    const uint64_t balPos = h + balBvRank_(slpId - h);
-    const uint64_t leftLen = decLeftVarLen(varLen, bal_[balPos]);
-    if (pos < leftLen) {
-      expandSubstr(pos, len, str, leftLen, vlc_[2 * slpId]);
-      if (leftLen - pos < len) {
-        expandPref(len - (leftLen - pos), str + (leftLen - pos), varLen - leftLen, vlc_[2 * slpId + 1]);
+    // descend to the leaf at pos, keeping the right siblings that follow it
+    auto & pending = expandStack();
+    pending.clear();
+    uint64_t p = pos;
+    uint64_t curLen = varLen;
+    var_t offset = slpOffset;
+    while (curLen > 1) {
+      uint64_t slpId;
+      const uint64_t leftLen = getLeftLen(curLen, offset, slpId);
+      const uint64_t slot = hotSlot(slpId);
+      if (slot != kNotHot) {
+        const uint64_t k = std::min(len, curLen - p);
+        hotExpand(slot, p, k, str);
+        expandPending(len - k, str + k);
+        return;
+      }
+      if (p < leftLen) {
+        if (leftLen - p < len) {
+          pending.push_back(std::make_pair(curLen - leftLen, vlc_[2 * slpId + 1]));
+        }
+        curLen = leftLen;
+        offset = vlc_[2 * slpId];
+      } else {
+        p -= leftLen;
+        curLen -= leftLen;
+        offset = vlc_[2 * slpId + 1];
       }
-    } else {
-      expandSubstr(pos - leftLen, len, str, varLen - leftLen, vlc_[2 * slpId + 1]);
     }
+    *str = alph_[offset];
+    expandPending(len - 1, str + 1);
   }
 
 
@@ -197,18 +244,361 @@ public:
     // std::cout << "len = " << len << ", varLen = " << varLen << ", stgOffset = " << stgOffset << ", slpOffset = " << slpOffset << std::endl;
     assert(len > 0);
 
-    if (varLen == 1) {
-      *str = alph_[slpOffset];
+    auto & pending = expandStack();
+    pending.clear();
+    pending.push_back(std::make_pair(varLen, slpOffset));
+    expandPending(len, str);
+  }
+
+
+  char getLeafChar
+  (
+   const nodeT & node
+   ) const {
+    assert(std::get<0>(node) == 1); // len == 1
+    return static_cast<char>(std::get<1>(node)); // the id of a leaf is its character
+  }
+
+
+  /*!
+   * Materializes the expansions of the variables visited most often by the descents to the positions in profile,
+   * e.g., the positions that the queries start from, within budget bytes. Without a profile, positions evenly
+   * spaced over the text are used. Descents reaching a hot variable read their characters directly,
+   * and hotLcp compares two hot variables a word at a time. An empty budget drops the cache.
+   */
+  void makeHotCache
+  (
+   const uint64_t budget,
+   const std::vector<uint64_t> & profile = {}
+   ) {
+    clearHotCache();
+    const uint64_t numRules = getNumRulesOfSlp();
+    const uint64_t words = (numRules + 63) / 64;
+    if (budget <= 2 * words * sizeof(uint64_t) or getLen() == 0) {
       return;
     }
-    const uint64_t h = hashLen(varLen);
-    const uint64_t slpId = slpDivSel_(h + 1) + slpOffset;
-    const uint64_t balPos = h + balBvRank_(slpId - h);
-    const uint64_t leftLen = decLeftVarLen(varLen, bal_[balPos]);
-    expandPref(len, str, leftLen, vlc_[2 * slpId]);
-    if (len > leftLen) {
-      expandPref(len - leftLen, str + leftLen, varLen - leftLen, vlc_[2 * slpId + 1]);
+
+    //// (visits, expansion length, slp offset) of each visited variable
+    std::unordered_map<uint64_t, std::tuple<uint64_t, uint64_t, var_t>> visits;
+    auto visit = [&](const uint64_t pos) {
+      const uint64_t seqPos = seqRank_(pos + 1);
+      uint64_t p = pos - ((seqPos > 0) ? seqSel_(seqPos) : 0);
+      uint64_t len = lenOfSeqAt(seqPos);
+      var_t offset = vlcSeq_[seqPos];
+      while (len >= kMinHotLen) {
+        uint64_t slpId;
+        const uint64_t leftLen = getLeftLen(len, offset, slpId);
+        auto & v = visits[slpId];
+        v = std::make_tuple(std::get<0>(v) + 1, len, offset);
+        if (p < leftLen) {
+          len = leftLen;
+          offset = vlc_[2 * slpId];
+        } else {
+          p -= leftLen;
+          len -= leftLen;
+          offset = vlc_[2 * slpId + 1];
+        }
+      }
+    };
+    if (profile.empty()) {
+      const uint64_t step = std::max<uint64_t>(1, getLen() / kHotProfileSize);
+      for (uint64_t pos = 0; pos < getLen(); pos += step) {
+        visit(pos);
+      }
+    } else {
+      for (const uint64_t pos : profile) {
+        if (pos < getLen()) {
+          visit(pos);
+        }
+      }
+    }
+
+    std::vector<std::pair<uint64_t, std::tuple<uint64_t, uint64_t, var_t>>> candidates(visits.begin(), visits.end());
+    std::sort
+      (
+       candidates.begin(),
+       candidates.end(),
+       [](const auto & x, const auto & y) {
+         return std::get<0>(x.second) > std::get<0>(y.second) or
+           (std::get<0>(x.second) == std::get<0>(y.second) and std::get<1>(x.second) < std::get<1>(y.second));
+       }
+       );
+
+    uint64_t width = 1;
+    while ((1ULL << width) < getAlphSize()) {
+      width *= 2;
+    }
+    std::vector<uint8_t> code(256, 0);
+    for (uint64_t i = 0; i < getAlphSize(); ++i) {
+      code[static_cast<uint8_t>(alph_[i])] = i;
+    }
+
+    //// the hot variables, in order of id
+    std::vector<std::pair<uint64_t, std::pair<uint64_t, var_t>>> hot;
+    uint64_t used = 2 * words * sizeof(uint64_t);
+    for (const auto & c : candidates) {
+      const uint64_t bytes = ((std::get<1>(c.second) * width + 63) / 64 + 1) * sizeof(uint64_t);
+      if (used + bytes <= budget) {
+        used += bytes;
+        hot.push_back(std::make_pair(c.first, std::make_pair(std::get<1>(c.second), std::get<2>(c.second))));
+      }
+    }
+    std::sort(hot.begin(), hot.end());
+
+    std::vector<uint64_t> bits(words, 0);
+    std::vector<uint64_t> rank(words, 0);
+    std::vector<uint64_t> start;
+    std::vector<uint64_t> data;
+    std::vector<char> buf;
+    for (const auto & h : hot) {
+      bits[h.first / 64] |= 1ULL << (h.first % 64);
+      const uint64_t len = h.second.first;
+      buf.resize(len);
+      expandPref(len, buf.data(), len, h.second.second);
+      start.push_back(data.size());
+      data.resize(data.size() + (len * width + 63) / 64, 0);
+      uint64_t * w = data.data() + start.back();
+      for (uint64_t i = 0; i < len; ++i) {
+        w[i * width / 64] |= static_cast<uint64_t>(code[static_cast<uint8_t>(buf[i])]) << (i * width % 64);
+      }
+    }
+    for (uint64_t i = 1; i < words; ++i) {
+      rank[i] = rank[i - 1] + __builtin_popcountll(bits[i - 1]);
+    }
+
+    hotWidth_ = width;
+    hotBits_ = std::move(bits);
+    hotRank_ = std::move(rank);
+    hotStart_ = std::move(start);
+    hotData_ = std::move(data);
+  }
+
+
+  void clearHotCache() {
+    hotWidth_ = 0;
+    hotBits_ = std::vector<uint64_t>();
+    hotRank_ = std::vector<uint64_t>();
+    hotStart_ = std::vector<uint64_t>();
+    hotData_ = std::vector<uint64_t>();
+  }
+
+
+  //// number of hot variables and bytes taken by the hot cache
+  std::pair<uint64_t, uint64_t> getHotCacheSize() const {
+    const uint64_t bytes = (hotBits_.size() + hotRank_.size() + hotStart_.size() + hotData_.size()) * sizeof(uint64_t);
+    return std::make_pair(hotStart_.size(), bytes);
+  }
+
+
+  /*!
+   * Length of the longest common prefix of the expansions of the nodes n1 and n2, of the same length,
+   * computed a word at a time if both of them are hot. Returns UINT64_MAX if one of them is not hot.
+   */
+  uint64_t hotLcp
+  (
+   const nodeT & n1,
+   const nodeT & n2
+   ) const {
+    const uint64_t len = std::get<0>(n1);
+    assert(len == std::get<0>(n2));
+    if (len <= 1) { // the ids of leaves are characters
+      return UINT64_MAX;
+    }
+    const uint64_t slot1 = hotSlot(std::get<1>(n1));
+    const uint64_t slot2 = hotSlot(std::get<1>(n2));
+    if (slot1 == kNotHot or slot2 == kNotHot) {
+      return UINT64_MAX;
+    }
+    const uint64_t * w1 = hotData_.data() + hotStart_[slot1];
+    const uint64_t * w2 = hotData_.data() + hotStart_[slot2];
+    const uint64_t charsPerWord = 64 / hotWidth_;
+    for (uint64_t i = 0; i * charsPerWord < len; ++i) {
+      const uint64_t diff = w1[i] ^ w2[i];
+      if (diff) {
+        return std::min(len, i * charsPerWord + __builtin_ctzll(diff) / hotWidth_);
+      }
+    }
+    return len;
+  }
+
+
+  /*!
+   * Computes the Karp-Rabin fingerprint sum_i T[p+i] * b^i mod 2^61-1 of the expansion of every variable,
+   * and of the text before every variable of the top-level sequence, for a base b drawn from seed.
+   * The fingerprint of any substring is then extracted with a root-to-leaf descent (fingerprint),
+   * and lceByFingerprint computes LCEs in time independent of how the grammar parsed the two suffixes.
+   * Takes 8 bytes per rule, plus 8 bytes per distinct expansion length and 16 bytes per variable of the top-level sequence.
+   */
+  void makeFingerprints
+  (
+   const uint64_t seed = 0
+   ) {
+    clearFingerprints();
+    std::mt19937_64 rnd(seed);
+    krBase_ = 256 + rnd() % (kKrPrime - 512);
+    krBaseInv_ = krPow(krBase_, kKrPrime - 2);
+    krVar_.assign(getNumRulesOfSlp(), 0);
+    krPow_.assign(rs_->size(), 0);
+    std::vector<bool> done(getNumRulesOfSlp(), false);
+
+    //// post-order traversal of the variables (expansion length, slp offset, id), computing each one once
+    std::vector<std::tuple<uint64_t, var_t, uint64_t>> stack;
+    auto push = [&](const uint64_t len, const var_t offset) {
+      if (len > 1) {
+        const uint64_t id = getId(len, offset);
+        if (not done[id]) {
+          stack.push_back(std::make_tuple(len, offset, id));
+        }
+      }
+    };
+    for (uint64_t i = 0; i < getLenSeq(); ++i) {
+      push(lenOfSeqAt(i), vlcSeq_[i]);
+      while (not stack.empty()) {
+        const uint64_t len = std::get<0>(stack.back());
+        const var_t offset = std::get<1>(stack.back());
+        const uint64_t id = std::get<2>(stack.back());
+        if (done[id]) {
+          stack.pop_back();
+          continue;
+        }
+        uint64_t slpId;
+        const uint64_t leftLen = getLeftLen(len, offset, slpId);
+        const var_t leftOffset = vlc_[2 * slpId];
+        const var_t rightOffset = vlc_[2 * slpId + 1];
+        const size_t top = stack.size();
+        push(leftLen, leftOffset);
+        push(len - leftLen, rightOffset);
+        if (stack.size() > top) {
+          continue;
+        }
+        stack.pop_back();
+        krVar_[id] = krAdd(krOfVar(leftLen, leftOffset), krMul(krPowOfLen(leftLen), krOfVar(len - leftLen, rightOffset)));
+        krPow_[hashLen(len)] = krMul(krPowOfLen(leftLen), krPowOfLen(len - leftLen));
+        done[id] = true;
+      }
+    }
+
+    krSeq_.assign(getLenSeq() + 1, 0);
+    krSeqPow_.assign(getLenSeq() + 1, 1);
+    for (uint64_t i = 0; i < getLenSeq(); ++i) {
+      const uint64_t len = lenOfSeqAt(i);
+      krSeq_[i + 1] = krAdd(krSeq_[i], krMul(krSeqPow_[i], krOfVar(len, vlcSeq_[i])));
+      krSeqPow_[i + 1] = krMul(krSeqPow_[i], krPowOfLen(len));
+    }
+  }
+
+
+  void clearFingerprints() {
+    krBase_ = 0;
+    krBaseInv_ = 0;
+    krVar_ = std::vector<uint64_t>();
+    krPow_ = std::vector<uint64_t>();
+    krSeq_ = std::vector<uint64_t>();
+    krSeqPow_ = std::vector<uint64_t>();
+  }
+
+
+  bool hasFingerprints() const {
+    return krBase_ != 0;
+  }
+
+
+  //// fingerprint of T[0..pos), for pos <= getLen(); the nodes of its descent count in slpVisitedNodes
+  uint64_t prefixFingerprint
+  (
+   const uint64_t pos
+   ) const {
+    assert(hasFingerprints());
+    assert(pos <= getLen());
+    if (pos == getLen()) {
+      return krSeq_.back();
     }
+    const uint64_t seqPos = seqRank_(pos + 1);
+    uint64_t p = pos - ((seqPos > 0) ? seqSel_(seqPos) : 0);
+    uint64_t len = lenOfSeqAt(seqPos);
+    var_t offset = vlcSeq_[seqPos];
+    uint64_t fp = krSeq_[seqPos];
+    uint64_t mult = krSeqPow_[seqPos];
+    uint64_t visited = 1;
+    while (p > 0) { // the fingerprint of the first p characters of the variable
+      ++visited;
+      uint64_t slpId;
+      const uint64_t leftLen = getLeftLen(len, offset, slpId);
+      if (p < leftLen) {
+        len = leftLen;
+        offset = vlc_[2 * slpId];
+      } else {
+        fp = krAdd(fp, krMul(mult, krOfVar(leftLen, vlc_[2 * slpId])));
+        mult = krMul(mult, krPowOfLen(leftLen));
+        p -= leftLen;
+        len -= leftLen;
+        offset = vlc_[2 * slpId + 1];
+      }
+    }
+    slpVisitedNodes() += visited;
+    return fp;
+  }
+
+
+  //// fingerprint of T[pos..pos+len)
+  uint64_t fingerprint
+  (
+   const uint64_t pos,
+   const uint64_t len
+   ) const {
+    assert(pos + len <= getLen());
+    const uint64_t diff = krSub(prefixFingerprint(pos + len), prefixFingerprint(pos));
+    return krMul(diff, krPow(krBaseInv_, pos)); // divided by krBase_^pos
+  }
+
+
+  /*!
+   * Length of the longest common prefix of T[p1..] and T[p2..] up to upperbound, by an exponential search
+   * followed by a binary search over the fingerprints. Correct with high probability over the choice of the base.
+   * Returns UINT64_MAX if the fingerprints have not been computed.
+   */
+  uint64_t lceByFingerprint
+  (
+   const uint64_t p1,
+   const uint64_t p2,
+   const uint64_t upperbound
+   ) const {
+    if (not hasFingerprints()) {
+      return UINT64_MAX;
+    }
+    if (p1 >= getLen() or p2 >= getLen()) {
+      return 0;
+    }
+    const uint64_t maxLen = std::min(getLen() - std::max(p1, p2), upperbound);
+    if (p1 == p2) {
+      return maxLen;
+    }
+    //// T[p1..p1+l) == T[p2..p2+l) iff (G(p1+l) - G(p1)) * b^p2 == (G(p2+l) - G(p2)) * b^p1, where G is prefixFingerprint
+    const uint64_t fp1 = prefixFingerprint(p1);
+    const uint64_t fp2 = prefixFingerprint(p2);
+    const uint64_t pow1 = krPow(krBase_, p1);
+    const uint64_t pow2 = krPow(krBase_, p2);
+    auto equal = [&](const uint64_t l) {
+      return krMul(krSub(prefixFingerprint(p1 + l), fp1), pow2) == krMul(krSub(prefixFingerprint(p2 + l), fp2), pow1);
+    };
+    uint64_t lo = 0; // longest length known to match
+    uint64_t hi = maxLen + 1; // shortest length known to mismatch
+    for (uint64_t l = 1; l <= maxLen; l *= 2) {
+      if (not equal(l)) {
+        hi = l;
+        break;
+      }
+      lo = l;
+    }
+    while (hi - lo > 1) {
+      const uint64_t mid = lo + (hi - lo) / 2;
+      if (equal(mid)) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
   }
 
 
@@ -394,6 +784,9 @@ public:
     vlcSeq_.load(in);
     vlc_.load(in);
     bal_.load(in);
+    makeDirectHash();
+    clearHotCache();
+    clearFingerprints();
   }
 
   void serialize
@@ -444,8 +837,160 @@ private:
   }
 
 
+  //// same value as (*rs_)(uint2Str(len)), without building a std::string
+  uint64_t hashLenRs(const uint64_t len) const {
+    char key[8];
+    for (uint64_t i = 0; i < 8; ++i) {
+      key[i] = (len >> (8 * i)) & 0xFF;
+    }
+    return (*rs_)(sux::function::spooky(key, sizeof(key), 0));
+  }
+
+
   uint64_t hashLen(uint64_t len) const {
-    return (*rs_)(uint2Str(len));
+    if (len < directHash_.size()) {
+      return directHash_[len];
+    }
+    return hashLenRs(len);
+  }
+
+
+  //// tabulates rs_ for the lengths up to kDirectLen, which are the most frequent ones in a descent
+  void makeDirectHash() {
+    directHash_.resize(std::min<uint64_t>(kDirectLen, getLen() + 1));
+    for (uint64_t len = 0; len < directHash_.size(); ++len) {
+      directHash_[len] = hashLenRs(len);
+    }
+  }
+
+
+  //// returns the expansion length of the left child of the variable of expansion length varLen > 1 at slpOffset,
+  //// and sets slpId to its id
+  uint64_t getLeftLen
+  (
+   const uint64_t varLen,
+   const var_t slpOffset,
+   uint64_t & slpId
+   ) const {
+    const uint64_t h = hashLen(varLen);
+    slpId = slpDivSel_(h + 1) + slpOffset;
+    const uint64_t balPos = h + balBvRank_(slpId - h);
+    return decLeftVarLen(varLen, bal_[balPos]);
+  }
+
+
+  static uint64_t krAdd(const uint64_t a, const uint64_t b) {
+    const uint64_t r = a + b;
+    return (r >= kKrPrime) ? r - kKrPrime : r;
+  }
+
+
+  static uint64_t krSub(const uint64_t a, const uint64_t b) {
+    return (a >= b) ? a - b : a + kKrPrime - b;
+  }
+
+
+  static uint64_t krMul(const uint64_t a, const uint64_t b) {
+    const __uint128_t x = static_cast<__uint128_t>(a) * b;
+    uint64_t r = static_cast<uint64_t>(x & kKrPrime) + static_cast<uint64_t>(x >> 61);
+    r = (r & kKrPrime) + (r >> 61);
+    return (r >= kKrPrime) ? r - kKrPrime : r;
+  }
+
+
+  static uint64_t krPow(uint64_t b, uint64_t e) {
+    uint64_t r = 1;
+    for (; e; e >>= 1) {
+      if (e & 1) {
+        r = krMul(r, b);
+      }
+      b = krMul(b, b);
+    }
+    return r;
+  }
+
+
+  //// krBase_ to the power of len, the expansion length of a variable
+  uint64_t krPowOfLen(const uint64_t len) const {
+    return (len == 1) ? krBase_ : krPow_[hashLen(len)];
+  }
+
+
+  //// fingerprint of the expansion of the variable of expansion length len at slpOffset
+  uint64_t krOfVar(const uint64_t len, const var_t slpOffset) const {
+    return (len == 1) ? static_cast<uint8_t>(alph_[slpOffset]) : krVar_[getId(len, slpOffset)];
+  }
+
+
+  //// index in hotStart_ of the hot variable slpId, or kNotHot
+  uint64_t hotSlot(const uint64_t slpId) const {
+    if (hotBits_.empty()) {
+      return kNotHot;
+    }
+    const uint64_t word = hotBits_[slpId / 64];
+    const uint64_t bit = 1ULL << (slpId % 64);
+    if (not (word & bit)) {
+      return kNotHot;
+    }
+    return hotRank_[slpId / 64] + __builtin_popcountll(word & (bit - 1));
+  }
+
+
+  //// index in alph_ of the character at relative position pos of the hot variable at slot
+  uint64_t hotCode(const uint64_t slot, const uint64_t pos) const {
+    const uint64_t bit = pos * hotWidth_;
+    return (hotData_[hotStart_[slot] + bit / 64] >> (bit % 64)) & ((1ULL << hotWidth_) - 1);
+  }
+
+
+  //// writes len characters of the hot variable at slot from relative position pos
+  void hotExpand(const uint64_t slot, const uint64_t pos, const uint64_t len, char * str) const {
+    for (uint64_t i = 0; i < len; ++i) {
+      str[i] = alph_[hotCode(slot, pos + i)];
+    }
+  }
+
+
+  //// variables (expansion length, slp offset) still to be expanded by expandPending, the next one on top
+  static PathArray<std::pair<uint64_t, var_t>> & expandStack() {
+    thread_local PathArray<std::pair<uint64_t, var_t>> pending;
+    return pending;
+  }
+
+
+  //// writes the first len characters of the concatenation of the variables in expandStack, from the top
+  void expandPending
+  (
+   uint64_t len,
+   char * str
+   ) const {
+    auto & pending = expandStack();
+    while (len > 0 and not pending.empty()) {
+      uint64_t curLen = pending.back().first;
+      var_t offset = pending.back().second;
+      pending.pop_back();
+      while (curLen > 1) {
+        uint64_t slpId;
+        const uint64_t leftLen = getLeftLen(curLen, offset, slpId);
+        const uint64_t slot = hotSlot(slpId);
+        if (slot != kNotHot) {
+          const uint64_t k = std::min(len, curLen);
+          hotExpand(slot, 0, k, str);
+          str += k;
+          len -= k;
+          break;
+        }
+        if (len > leftLen) {
+          pending.push_back(std::make_pair(curLen - leftLen, vlc_[2 * slpId + 1]));
+        }
+        curLen = leftLen;
+        offset = vlc_[2 * slpId];
+      }
+      if (curLen == 1) {
+        *str++ = alph_[offset];
+        --len;
+      }
+    }
   }
 
 
@@ -574,6 +1119,7 @@ private:
         keys.push_back(uint2Str(*itr));
       }
       rs_ = new sux::function::RecSplit<kLeaf>(keys, kBucketSize);
+      makeDirectHash();
     }
 
     std::vector<var_t> slpOrder(slp.getNumRules());
@@ -0,0 +1,178 @@
+#ifndef INCLUDE_GUARD_SlpIterator
+#define INCLUDE_GUARD_SlpIterator
+
+#include <stdint.h> // include uint64_t etc.
+#include <algorithm>
+#include <vector>
+#include "Common.hpp"
+
+
+/*!
+ * Iterator over the characters of the text of an SLP (SelfShapedSlp or PlainSlp).
+ * It keeps the path from the root to the leaf of the current position, so that moving to an
+ * adjacent position only replaces the part of the path below their lowest common ancestor,
+ * which takes amortized O(1) time on sequential scans instead of a root-to-leaf descent per character.
+ * Once it moves out of the text it is no longer valid and has to be seeked again.
+ */
+template<class SlpT>
+class SlpIterator
+{
+public:
+  using nodeT = typename SlpT::nodeT;
+
+
+  SlpIterator
+  (
+   const SlpT & slp,
+   const uint64_t pos = 0
+   ) : slp_(slp)
+  {
+    seek(pos);
+  }
+
+
+  //// moves the iterator to pos, that is not valid if pos >= getLen()
+  void seek
+  (
+   const uint64_t pos
+   ) {
+    path_.clear();
+    pos_ = pos;
+    if (pos >= slp_.getLen()) {
+      return;
+    }
+    getPrefixPath(slp_, path_, pos);
+    descentToFirstLeaf();
+  }
+
+
+  bool valid() const {
+    return !path_.empty();
+  }
+
+
+  uint64_t pos() const {
+    return pos_;
+  }
+
+
+  char operator*() const {
+    assert(valid());
+    return slp_.getLeafChar(path_.top());
+  }
+
+
+  SlpIterator & operator++() {
+    assert(valid());
+    ++pos_;
+    if (proceedPrefixPath(slp_, path_)) {
+      descentToFirstLeaf();
+    } else {
+      path_.clear();
+    }
+    return *this;
+  }
+
+
+  SlpIterator & operator--() {
+    assert(valid());
+    --pos_;
+    if (retreatPrefixPath(slp_, path_)) {
+      descentToLastLeaf();
+    } else {
+      path_.clear();
+    }
+    return *this;
+  }
+
+
+private:
+  const SlpT & slp_;
+  SlpPath<nodeT> path_;
+  uint64_t pos_;
+
+
+  void descentToFirstLeaf() {
+    if (path_.size() == 1) {
+      path_.push(slp_.getChildNode_Root(0));
+    }
+    while (std::get<0>(path_.top()) > 1) {
+      path_.push(slp_.getChildNode(path_.top(), 0));
+    }
+  }
+
+
+  void descentToLastLeaf() {
+    while (std::get<0>(path_.top()) > 1) {
+      path_.push(slp_.getChildNode(path_.top(), 1));
+    }
+  }
+};
+
+
+/*!
+ * Random access to the characters of the text of an SLP that decodes a block of characters with
+ * expandSubstr on a miss. The block starts at kMinBlock characters and doubles up to kMaxBlock as long
+ * as the accesses continue where the previous block ends, so that short scans do not decode much more
+ * than they read and long scans pay one expansion every kMaxBlock characters.
+ */
+template<class SlpT>
+class SlpBlockReader
+{
+public:
+  static constexpr uint64_t kMinBlock = 64;
+  static constexpr uint64_t kMaxBlock = 4096;
+
+
+  SlpBlockReader
+  (
+   const SlpT & slp
+   ) : slp_(slp), buf_(kMaxBlock)
+  {}
+
+
+  char operator[]
+  (
+   const uint64_t pos
+   ) {
+    assert(pos < slp_.getLen());
+    if (pos - begin_ >= len_) { // also when pos < begin_
+      block_ = (pos == begin_ + len_) ? std::min(2 * block_, kMaxBlock) : kMinBlock;
+      begin_ = pos;
+      len_ = std::min(block_, slp_.getLen() - pos);
+      slp_.expandSubstr(pos, len_, buf_.data());
+    }
+    return buf_[pos - begin_];
+  }
+
+
+  /*!
+   * Length of the longest common prefix of the text from pos and str[0..len),
+   * that is known to be at least l.
+   */
+  template<class CharT>
+  uint64_t extendMatch
+  (
+   const uint64_t pos,
+   const CharT * str,
+   const uint64_t len,
+   uint64_t l = 0
+   ) {
+    const uint64_t m = (pos < slp_.getLen()) ? std::min(len, slp_.getLen() - pos) : 0;
+    while (l < m and static_cast<char>(str[l]) == (*this)[pos + l]) {
+      ++l;
+    }
+    return l;
+  }
+
+
+private:
+  const SlpT & slp_;
+  std::vector<char> buf_;
+  uint64_t begin_ = 0;
+  uint64_t len_ = 0;
+  uint64_t block_ = kMinBlock / 2;
+};
+
+
+#endif
@@ -157,6 +157,8 @@ void map_file(const char *filename, T*& ptr, size_t& length){
 
     if ((ptr = reinterpret_cast<T*>(mmap(NULL, filestat.st_size, PROT_READ, MAP_SHARED, fd, 0))) == MAP_FAILED)
         error("mmap() file " + std::string(filename) + " failed");
+
+    close(fd); // the mapping stays valid
 }
 
 template<typename T>
@@ -333,7 +335,20 @@ struct Args
   bool csv   = false; // print stats on stderr in csv format
   bool rle   = false; // outpt RLBWT
   std::string patterns = ""; // path to patterns file
-  bool is_fasta = false; // read a fasta file
+  bool is_fasta = false; // read the patterns from a fasta or fastq file, possibly gzipped
+  size_t th = 1; // number of threads
+  size_t batch = 1; // number of patterns queried in lockstep by each thread
+  size_t snippets = 0; // characters stored after each run boundary sample (0 to disable)
+  bool move  = false; // store the move table of the BWT runs
+  bool dna   = false; // use the DNA alphabet for the run heads
+  size_t hot_cache = 0; // MiB of expansions of hot grammar variables cached at query time (0 to disable)
+  bool fingerprints = false; // compute the LCEs with Karp-Rabin fingerprints of the grammar
+  std::string stats = ""; // path of the query statistics report, in CSV if it ends with .csv and in JSON otherwise
+  std::string trace = ""; // path of the trace of the LF, select and LCE calls of the queries
+  bool thresholds = false; // compute the thresholds of the runs, to compute one LCE per mismatch step
+  bool pointers_only = false; // compute only the pointers, choosing them with the thresholds
+  std::string recover = ""; // lengths recovered from the pointers: all, max, or the minimum length
+  size_t chunk = 0; // characters per chunk of a pattern queried by all the threads, 0 for one thread per pattern
 };
 
 void parseArgs(int argc, char *const argv[], Args &arg)
@@ -342,18 +357,35 @@ void parseArgs(int argc, char *const argv[], Args &arg)
   extern char *optarg;
   extern int optind;
 
-  std::string usage("usage: " + std::string(argv[0]) + " infile [-s store] [-m memo] [-c csv] [-p patterns] [-f fasta] [-r rle]\n\n" +
+  std::string usage("usage: " + std::string(argv[0]) + " infile [-s store] [-m memo] [-c csv] [-p patterns] [-f fasta] [-r rle] [-t threads] [-b batch] [-k snippets] [-M move] [-d dna] [-H hot] [-K fingerprints] [-S stats] [-T trace] [-g thresholds] [-P pointers] [-R recover] [-L chunk]\n\n" +
                     "Computes the pfp data structures of infile, provided that infile.parse, infile.dict, and infile.occ exists.\n" +
                     "  wsize: [integer] - sliding window size (def. 10)\n" +
                     "  store: [boolean] - store the data structure in infile.pfp.ds. (def. false)\n" +
                     "   memo: [boolean] - print the data structure memory usage. (def. false)\n" +
-                    "  fasta: [boolean] - the input file is a fasta file. (def. false)\n" +
+                    "  fasta: [boolean] - patterns is a FASTA or FASTQ file, possibly gzipped, instead of patterns.dir. (def. false)\n" +
                     "    rle: [boolean] - output run length encoded BWT. (def. false)\n" +
                     "pattens: [string]  - path to patterns file.\n" +
+                    "threads: [integer] - number of threads. (def. 1)\n" +
+                    "  batch: [integer] - number of patterns queried in lockstep by each thread. (def. 1)\n" +
+                    "snippets: [integer] - characters stored after each run boundary sample. (def. 0)\n" +
+                    "   move: [boolean] - store the move table of the BWT runs. (def. false)\n" +
+                    "    dna: [boolean] - store the run heads over the alphabet {A,C,G,T,N}. (def. false)\n" +
+                    "    hot: [integer] - MiB of expansions of hot grammar variables cached at query time. (def. 0)\n" +
+                    "fingerprints: [boolean] - compute the LCEs with Karp-Rabin fingerprints of the grammar. (def. false)\n" +
+                    "  stats: [string]  - path of the query statistics report, CSV if it ends with .csv, JSON otherwise.\n" +
+                    "  trace: [string]  - path of the binary trace of the LF, select and LCE calls, replayed by phoni_replay.\n" +
+                    "thresholds: [boolean] - compute the thresholds of the runs, with the threads of -t, to compute one LCE per mismatch step. (def. false)\n" +
+                    "pointers: [boolean] - compute only the pointers, without any LCE. Needs the thresholds. (def. false)\n" +
+                    "recover: [string]  - compute the pointers as -P, then the lengths from them: all, max for the positions whose\n" +
+                    "                     match is not contained in the match of the previous position, or a minimum length.\n" +
+                    "                     The other lengths are written as 0.\n" +
+                    "  chunk: [integer] - query the patterns one at a time, each one in chunks of this many characters\n" +
+                    "                     with all the threads, for chromosome-length patterns. The lengths are those of the\n" +
+                    "                     sequential query, the pointers can differ on ties. (def. 0, one thread per pattern)\n" +
                     "    csv: [boolean] - print the stats in csv form on strerr. (def. false)\n");
 
   std::string sarg;
-  while ((c = getopt(argc, argv, "w:smcfrhp:")) != -1)
+  while ((c = getopt(argc, argv, "w:smcfrhp:t:b:k:MdH:KS:T:gPR:L:")) != -1)
   {
     switch (c)
     {
@@ -379,6 +411,51 @@ void parseArgs(int argc, char *const argv[], Args &arg)
     case 'f':
       arg.is_fasta = true;
       break;
+    case 't':
+      sarg.assign(optarg);
+      arg.th = stoi(sarg);
+      break;
+    case 'b':
+      sarg.assign(optarg);
+      arg.batch = stoi(sarg);
+      break;
+    case 'k':
+      sarg.assign(optarg);
+      arg.snippets = stoi(sarg);
+      break;
+    case 'M':
+      arg.move = true;
+      break;
+    case 'd':
+      arg.dna = true;
+      break;
+    case 'H':
+      sarg.assign(optarg);
+      arg.hot_cache = stoi(sarg);
+      break;
+    case 'K':
+      arg.fingerprints = true;
+      break;
+    case 'S':
+      arg.stats.assign(optarg);
+      break;
+    case 'T':
+      arg.trace.assign(optarg);
+      break;
+    case 'g':
+      arg.thresholds = true;
+      break;
+    case 'P':
+      arg.pointers_only = true;
+      break;
+    case 'R':
+      arg.recover.assign(optarg);
+      arg.pointers_only = true;
+      break;
+    case 'L':
+      sarg.assign(optarg);
+      arg.chunk = stoul(sarg);
+      break;
     case 'h':
       error(usage);
     case '?':
@@ -0,0 +1,131 @@
+/* mapped_file - Read-only memory mapped files and streams over them
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file mapped_file.hpp
+   \brief mapped_file.hpp Read-only memory mapped files and streams over them.
+*/
+
+#ifndef _MAPPED_FILE_HH
+#define _MAPPED_FILE_HH
+
+#include <streambuf>
+#include <istream>
+
+#include <common.hpp>
+
+//! A file mapped read-only and shared, so that the processes mapping it share the page cache.
+class mapped_file
+{
+public:
+    mapped_file() {}
+
+    mapped_file(const std::string &filename)
+    {
+        struct stat filestat;
+        int fd;
+
+        if ((fd = open(filename.c_str(), O_RDONLY)) < 0)
+            error("open() file " + filename + " failed");
+
+        if (fstat(fd, &filestat) < 0)
+            error("stat() file " + filename + " failed");
+
+        length = filestat.st_size;
+        if (length > 0 && (ptr = reinterpret_cast<const char *>(mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0))) == MAP_FAILED)
+            error("mmap() file " + filename + " failed");
+
+        close(fd); // the mapping stays valid
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    mapped_file(mapped_file &&other) { swap(other); }
+
+    mapped_file &operator=(mapped_file &&other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        if (ptr != nullptr)
+            munmap((void *)ptr, length);
+    }
+
+    const char *data() const
+    {
+        return ptr;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    void swap(mapped_file &other)
+    {
+        std::swap(ptr, other.ptr);
+        std::swap(length, other.length);
+    }
+
+    const char *ptr = nullptr;
+    size_t length = 0;
+};
+
+//! Input stream buffer over a memory area, to deserialize from a mapped_file.
+class memory_streambuf : public std::streambuf
+{
+public:
+    memory_streambuf(const char *begin, const size_t size)
+    {
+        char *b = const_cast<char *>(begin);
+        setg(b, b, b + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in) override
+    {
+        char *target = (dir == std::ios_base::beg) ? eback() + off : (dir == std::ios_base::cur) ? gptr() + off : egptr() + off;
+        if (!(which & std::ios_base::in) || target < eback() || target > egptr())
+            return pos_type(off_type(-1));
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+//! std::istream reading a mapped_file, whose tellg() is the offset in the file.
+class mapped_istream : public std::istream
+{
+public:
+    mapped_istream(const mapped_file &file) : std::istream(nullptr), buf(file.data(), file.size())
+    {
+        rdbuf(&buf);
+    }
+
+private:
+    memory_streambuf buf;
+};
+
+#endif /* end of include guard: _MAPPED_FILE_HH */
@@ -0,0 +1,224 @@
+/* sequence_reader - Streaming reader of FASTA and FASTQ files, plain or gzipped
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file sequence_reader.hpp
+   \brief sequence_reader.hpp Streaming reader of FASTA and FASTQ files, plain or gzipped.
+*/
+
+#ifndef _SEQUENCE_READER_HH
+#define _SEQUENCE_READER_HH
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+
+#include <zlib.h>
+
+#include <common.hpp>
+
+//! Records read together, stored one after the other in a single buffer.
+/*!
+ * The buffer and the record table keep their capacity across batches, so
+ * that reading a batch allocates nothing once the largest batch has been seen.
+ */
+class sequence_batch
+{
+public:
+    size_t size() const
+    {
+        return records.size();
+    }
+
+    void clear()
+    {
+        arena.clear();
+        records.clear();
+    }
+
+    //! Header of the i-th record, without the leading > or @
+    std::string_view name(const size_t i) const
+    {
+        return std::string_view(arena.data() + records[i].name, records[i].sequence - records[i].name);
+    }
+
+    //! Sequence of the i-th record, with its lines joined
+    std::string_view sequence(const size_t i) const
+    {
+        return std::string_view(arena.data() + records[i].sequence, records[i].end - records[i].sequence);
+    }
+
+private:
+    friend class sequence_reader;
+
+    struct record
+    {
+        size_t name, sequence, end; //! offsets in arena
+    };
+
+    std::string arena;
+    std::vector<record> records;
+
+    void start_record()
+    {
+        records.push_back({arena.size(), arena.size(), arena.size()});
+    }
+
+    void start_sequence()
+    {
+        records.back().sequence = arena.size();
+    }
+
+    void end_record()
+    {
+        records.back().end = arena.size();
+    }
+};
+
+//! Reads the records of a FASTA or FASTQ file in batches, in constant memory.
+/*!
+ * The file is decompressed by zlib, which reads plain files as they are, in
+ * blocks of block_size bytes. Each line is copied once, from the block into
+ * the arena of the batch. The sequences of FASTA records can span several
+ * lines; FASTQ records can also, as long as the quality lines match them.
+ */
+class sequence_reader
+{
+public:
+    static const size_t block_size = 1 << 22;
+
+    sequence_reader(const std::string &filename) : file(gzopen(filename.c_str(), "rb")), block(block_size)
+    {
+        if (file == nullptr)
+            error("open() file " + filename + " failed");
+        gzbuffer(file, block_size);
+    }
+
+    sequence_reader(const sequence_reader &) = delete;
+    sequence_reader &operator=(const sequence_reader &) = delete;
+
+    ~sequence_reader()
+    {
+        gzclose(file);
+    }
+
+    //! Reads up to max_records records into batch, replacing its content. Returns false if there are none left
+    bool next(sequence_batch &batch, const size_t max_records)
+    {
+        batch.clear();
+        while (batch.size() < max_records && next_record(batch))
+            ;
+        return batch.size() > 0;
+    }
+
+private:
+    gzFile file;
+    std::vector<char> block;
+    size_t begin = 0, end = 0; //! unread bytes of block
+    bool eof = false;
+
+    //! Makes sure that the block has unread bytes, false at the end of the file
+    bool fill()
+    {
+        if (begin < end)
+            return true;
+        if (eof)
+            return false;
+        const int read = gzread(file, block.data(), block.size());
+        if (read < 0)
+            error("gzread() failed");
+        begin = 0;
+        end = read;
+        eof = (read == 0);
+        return !eof;
+    }
+
+    int peek()
+    {
+        return fill() ? static_cast<unsigned char>(block[begin]) : EOF;
+    }
+
+    //! Reads the rest of the current line, appending it to out if not null, and returns its length
+    //! The line terminator, \n or \r\n, is dropped
+    size_t read_line(std::string *out)
+    {
+        size_t length = 0;
+        bool carriage_return = false;
+        while (fill())
+        {
+            const char *p = block.data() + begin;
+            const char *newline = static_cast<const char *>(memchr(p, '\n', end - begin));
+            const size_t n = newline ? newline - p : end - begin;
+            if (out)
+                out->append(p, n);
+            length += n;
+            carriage_return = n > 0 ? p[n - 1] == '\r' : carriage_return;
+            begin += n;
+            if (newline)
+            {
+                ++begin;
+                break;
+            }
+        }
+        if (carriage_return)
+        {
+            if (out)
+                out->pop_back();
+            --length;
+        }
+        return length;
+    }
+
+    bool next_record(sequence_batch &batch)
+    {
+        int c;
+        while ((c = peek()) == '\n' || c == '\r')
+            read_line(nullptr);
+        if (c == EOF)
+            return false;
+        if (c != '>' && c != '@')
+            error("invalid FASTA or FASTQ record: it starts with ", char(c));
+        ++begin;
+
+        batch.start_record();
+        read_line(&batch.arena);
+        batch.start_sequence();
+        if (c == '>')
+        {
+            while ((c = peek()) != EOF && c != '>')
+                read_line(&batch.arena);
+            batch.end_record();
+            return true;
+        }
+
+        while ((c = peek()) != EOF && c != '+')
+            read_line(&batch.arena);
+        batch.end_record();
+        if (c == EOF)
+            error("invalid FASTQ record: no quality line");
+        read_line(nullptr);
+        const size_t length = batch.records.back().end - batch.records.back().sequence;
+        size_t quality = 0;
+        while (quality < length && peek() != EOF)
+            quality += read_line(nullptr);
+        if (quality != length)
+            error("invalid FASTQ record: the quality does not match the sequence");
+        return true;
+    }
+};
+
+#endif /* end of include guard: _SEQUENCE_READER_HH */
@@ -0,0 +1,177 @@
+/* thread_pool - Work-stealing parallel loop and in-order result buffer
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file thread_pool.hpp
+   \brief thread_pool.hpp Work-stealing parallel loop and in-order result buffer.
+*/
+
+#ifndef _THREAD_POOL_HH
+#define _THREAD_POOL_HH
+
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+//! Runs f(item, thread_id) for every item in [0, n_items) on n_threads threads.
+/*!
+ * The items are cut into chunks of chunk_size consecutive items, and the chunks
+ * are dealt round-robin to per-thread queues. A thread works on the lowest
+ * chunk of its own queue and, once it is empty, steals the lowest pending chunk
+ * of the other threads. Taking always the lowest chunk keeps the items that are
+ * in flight close to each other, which bounds the reorder_buffer below.
+ */
+class work_stealing_pool
+{
+public:
+    work_stealing_pool(size_t n_threads_ = 1) : n_threads(n_threads_ == 0 ? 1 : n_threads_), queues(n_threads) {}
+
+    template <typename F>
+    void parallel_for(size_t n_items, size_t chunk_size, F f)
+    {
+        parallel_for_chunks(n_items, chunk_size, [&](const size_t begin, const size_t end, const size_t thread_id) {
+            for (size_t item = begin; item < end; ++item)
+                f(item, thread_id);
+        });
+    }
+
+    //! As parallel_for, but runs f(begin, end, thread_id) once for each chunk [begin, end).
+    template <typename F>
+    void parallel_for_chunks(size_t n_items, size_t chunk_size, F f)
+    {
+        if (chunk_size == 0)
+            chunk_size = 1;
+        const size_t n_chunks = (n_items + chunk_size - 1) / chunk_size;
+
+        for (size_t i = 0; i < n_threads; ++i)
+            queues[i].chunks.clear();
+        for (size_t c = 0; c < n_chunks; ++c)
+            queues[c % n_threads].chunks.push_back(c);
+
+        auto worker = [&](const size_t thread_id) {
+            size_t chunk;
+            while (next_chunk(thread_id, chunk))
+                f(chunk * chunk_size, std::min(n_items, (chunk + 1) * chunk_size), thread_id);
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < n_threads; ++i)
+            threads.emplace_back(worker, i);
+        worker(0);
+        for (auto &t : threads)
+            t.join();
+    }
+
+    size_t size() const
+    {
+        return n_threads;
+    }
+
+private:
+    struct chunk_queue
+    {
+        std::mutex m;
+        std::deque<size_t> chunks;
+    };
+
+    bool next_chunk(const size_t thread_id, size_t &chunk)
+    {
+        if (pop(thread_id, chunk))
+            return true;
+        // Steal from the victim holding the lowest pending chunk
+        while (true)
+        {
+            size_t victim = n_threads;
+            size_t lowest = -1;
+            for (size_t i = 0; i < n_threads; ++i)
+            {
+                std::lock_guard<std::mutex> lock(queues[i].m);
+                if (!queues[i].chunks.empty() && queues[i].chunks.front() < lowest)
+                {
+                    lowest = queues[i].chunks.front();
+                    victim = i;
+                }
+            }
+            if (victim == n_threads)
+                return false;
+            if (pop(victim, chunk))
+                return true;
+        }
+    }
+
+    bool pop(const size_t i, size_t &chunk)
+    {
+        std::lock_guard<std::mutex> lock(queues[i].m);
+        if (queues[i].chunks.empty())
+            return false;
+        chunk = queues[i].chunks.front();
+        queues[i].chunks.pop_front();
+        return true;
+    }
+
+    const size_t n_threads;
+    std::vector<chunk_queue> queues;
+};
+
+//! Collects results produced out of order and hands them to a consumer in order.
+/*!
+ * push(i, value) stores the value of item i and, if i is the next expected
+ * item, flushes it together with all the following ready items. A producer
+ * whose item is capacity or more items ahead of the next expected item waits,
+ * so that the buffer never holds more than capacity results.
+ */
+template <typename T, typename Consumer>
+class reorder_buffer
+{
+public:
+    reorder_buffer(Consumer consumer_, size_t capacity_ = 1024) : consumer(consumer_), capacity(capacity_ == 0 ? 1 : capacity_) {}
+
+    void push(const size_t i, T &&value)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return i < next + capacity; });
+        pending.emplace(i, std::move(value));
+        bool flushed = false;
+        for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it))
+        {
+            consumer(it->second);
+            ++next;
+            flushed = true;
+        }
+        if (flushed)
+            cv.notify_all();
+    }
+
+    size_t flushed() const
+    {
+        return next;
+    }
+
+private:
+    Consumer consumer;
+    const size_t capacity;
+    size_t next = 0;
+    std::map<size_t, T> pending;
+    std::mutex m;
+    std::condition_variable cv;
+};
+
+#endif /* end of include guard: _THREAD_POOL_HH */
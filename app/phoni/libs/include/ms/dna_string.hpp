@@ -0,0 +1,144 @@
+/* dna_string - Run heads over the DNA alphabet with 3 bits per symbol
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file dna_string.hpp
+   \brief dna_string.hpp Run heads over the DNA alphabet with 3 bits per symbol.
+*/
+
+#ifndef _DNA_STRING_HH
+#define _DNA_STRING_HH
+
+#include <array>
+#include <vector>
+
+#include <common.hpp>
+
+#include <sdsl/int_vector.hpp>
+
+#include <sparse_sd_vector.hpp>
+
+//! Drop-in replacement of ri::huff_string for strings over {$,A,C,G,T,N}.
+/*!
+ * The symbols are remapped to the dense codes [0,6). Access reads a 3-bit
+ * code instead of decoding a Huffman-shaped wavelet tree, and rank and select
+ * use one sparse bitvector per code, marking the positions of that code.
+ */
+class dna_string
+{
+public:
+    static const size_t sigma = 6;
+
+    dna_string() {}
+
+    dna_string(std::string &s)
+    {
+        heads = sdsl::int_vector<3>(s.size());
+        std::vector<std::vector<bool>> positions(sigma, std::vector<bool>(s.size() + 1, false));
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            const uint8_t c = code(static_cast<uchar>(s[i]));
+            if (c == sigma)
+                error("symbol ", int(static_cast<uchar>(s[i])), " is not in the DNA alphabet");
+            heads[i] = c;
+            positions[c][i] = true;
+        }
+        heads_per_letter = std::vector<ri::sparse_sd_vector>(sigma);
+        for (size_t c = 0; c < sigma; ++c)
+            heads_per_letter[c] = ri::sparse_sd_vector(positions[c]);
+    }
+
+    uchar operator[](const ulint i) const
+    {
+        return symbols()[heads[i]];
+    }
+
+    ulint size() const
+    {
+        return heads.size();
+    }
+
+    //! Number of c before position i
+    ulint rank(const ulint i, const uchar c)
+    {
+        const uint8_t k = code(c);
+        if (k == sigma)
+            return 0;
+        return heads_per_letter[k].rank(i);
+    }
+
+    //! Position of the i-th c
+    ulint select(const ulint i, const uchar c)
+    {
+        return heads_per_letter[code(c)].select(i);
+    }
+
+    ulint serialize(std::ostream &out)
+    {
+        ulint w_bytes = heads.serialize(out);
+        for (size_t c = 0; c < sigma; ++c)
+            w_bytes += heads_per_letter[c].serialize(out);
+        return w_bytes;
+    }
+
+    void load(std::istream &in)
+    {
+        heads.load(in);
+        heads_per_letter = std::vector<ri::sparse_sd_vector>(sigma);
+        for (size_t c = 0; c < sigma; ++c)
+            heads_per_letter[c].load(in);
+    }
+
+private:
+    //! Dense code of the symbol c, sigma if c is not in the alphabet
+    static uint8_t code(const uchar c)
+    {
+        static const std::array<uint8_t, 256> codes = [] {
+            std::array<uint8_t, 256> codes;
+            codes.fill(sigma);
+            for (size_t k = 0; k < sigma; ++k)
+                codes[symbols()[k]] = k;
+            return codes;
+        }();
+        return codes[c];
+    }
+
+    static const std::array<uchar, sigma> &symbols()
+    {
+        static const std::array<uchar, sigma> symbols = {TERMINATOR, 'A', 'C', 'G', 'T', 'N'};
+        return symbols;
+    }
+
+    sdsl::int_vector<3> heads;
+    std::vector<ri::sparse_sd_vector> heads_per_letter;
+};
+
+//! Tag of the alphabet of the run heads, recorded in the .phoni file
+template <class string_t>
+struct alphabet_traits
+{
+    static const uint64_t tag = 0;
+    static constexpr const char *name = "generic";
+};
+
+template <>
+struct alphabet_traits<dna_string>
+{
+    static const uint64_t tag = 1;
+    static constexpr const char *name = "DNA";
+};
+
+#endif /* end of include guard: _DNA_STRING_HH */
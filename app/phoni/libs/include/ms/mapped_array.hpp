@@ -0,0 +1,208 @@
+/* mapped_array - Arrays either owned or viewed in a mapped file
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file mapped_array.hpp
+   \brief mapped_array.hpp Arrays either owned or viewed in a mapped file.
+*/
+
+#ifndef _MAPPED_ARRAY_HH
+#define _MAPPED_ARRAY_HH
+
+#include <vector>
+#include <type_traits>
+
+#include <common.hpp>
+
+#include <sdsl/int_vector.hpp>
+
+//! Read-only array of trivially copyable elements, whose elements can live in a mapped file.
+/*!
+ * The elements are serialized 8-byte aligned with respect to the beginning of
+ * the stream, so that loading from a mapped_istream can point to them in the
+ * mapping instead of copying them. The mapping must outlive the array.
+ */
+template <class T>
+class mapped_vector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "mapped_vector elements are copied as bytes");
+    static_assert(alignof(T) <= sizeof(uint64_t), "mapped_vector aligns its elements to 8 bytes");
+
+public:
+    mapped_vector() {}
+
+    mapped_vector(std::vector<T> &&v) : owned(std::move(v)), ptr(owned.data()), n(owned.size()) {}
+
+    mapped_vector(const mapped_vector &other) { *this = other; }
+
+    mapped_vector(mapped_vector &&other) { *this = std::move(other); }
+
+    mapped_vector &operator=(const mapped_vector &other)
+    {
+        const bool is_view = other.ptr != other.owned.data();
+        owned = other.owned;
+        ptr = is_view ? other.ptr : owned.data();
+        n = other.n;
+        return *this;
+    }
+
+    mapped_vector &operator=(mapped_vector &&other)
+    {
+        const bool is_view = other.ptr != other.owned.data();
+        const T *other_ptr = other.ptr;
+        owned = std::move(other.owned);
+        ptr = is_view ? other_ptr : owned.data();
+        n = other.n;
+        return *this;
+    }
+
+    const T &operator[](const size_t i) const
+    {
+        return ptr[i];
+    }
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    bool empty() const
+    {
+        return n == 0;
+    }
+
+    const T *data() const
+    {
+        return ptr;
+    }
+
+    const T *begin() const
+    {
+        return ptr;
+    }
+
+    const T *end() const
+    {
+        return ptr + n;
+    }
+
+    size_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const
+    {
+        sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+        size_t written_bytes = 0;
+
+        written_bytes += sdsl::write_member(n, out, child, "size");
+        for (; out.tellp() % sizeof(uint64_t) != 0; ++written_bytes)
+            out.put(0);
+        out.write((const char *)ptr, n * sizeof(T));
+        written_bytes += n * sizeof(T);
+
+        sdsl::structure_tree::add_size(child, written_bytes);
+        return written_bytes;
+    }
+
+    //! Loads the array, pointing to its elements in mapping if it is the memory read by in.
+    void load(std::istream &in, const char *mapping = nullptr)
+    {
+        sdsl::read_member(n, in);
+        while (in.tellg() % sizeof(uint64_t) != 0)
+            in.get();
+
+        if (mapping != nullptr)
+        {
+            owned = std::vector<T>();
+            ptr = reinterpret_cast<const T *>(mapping + in.tellg());
+            in.seekg(n * sizeof(T), std::ios_base::cur);
+        }
+        else
+        {
+            owned = std::vector<T>(n);
+            in.read((char *)owned.data(), n * sizeof(T));
+            ptr = owned.data();
+        }
+    }
+
+private:
+    std::vector<T> owned; // empty when viewing a mapping
+    const T *ptr = nullptr;
+    size_t n = 0;
+};
+
+//! Read-only sdsl::int_vector<> whose words can live in a mapped file.
+class packed_array
+{
+public:
+    packed_array() {}
+
+    packed_array(const sdsl::int_vector<> &v)
+        : words(std::vector<uint64_t>(v.data(), v.data() + (v.bit_size() + 63) / 64)), n(v.size()), w(v.width()) {}
+
+    uint64_t operator[](const size_t i) const
+    {
+        const size_t bit = i * w;
+        return sdsl::bits::read_int(words.data() + (bit >> 6), bit & 0x3F, w);
+    }
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    bool empty() const
+    {
+        return n == 0;
+    }
+
+    uint8_t width() const
+    {
+        return w;
+    }
+
+    const uint64_t *data() const
+    {
+        return words.data();
+    }
+
+    size_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const
+    {
+        sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+        size_t written_bytes = 0;
+
+        const uint64_t width = w;
+        written_bytes += sdsl::write_member(n, out, child, "size");
+        written_bytes += sdsl::write_member(width, out, child, "width");
+        written_bytes += words.serialize(out, child, "words");
+
+        sdsl::structure_tree::add_size(child, written_bytes);
+        return written_bytes;
+    }
+
+    void load(std::istream &in, const char *mapping = nullptr)
+    {
+        uint64_t width;
+        sdsl::read_member(n, in);
+        sdsl::read_member(width, in);
+        w = width;
+        words.load(in, mapping);
+    }
+
+private:
+    mapped_vector<uint64_t> words;
+    size_t n = 0;
+    uint8_t w = 64;
+};
+
+#endif /* end of include guard: _MAPPED_ARRAY_HH */
@@ -0,0 +1,223 @@
+/* move_table - Run table answering LF by moving between BWT runs
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file move_table.hpp
+   \brief move_table.hpp Run table answering LF by moving between BWT runs.
+*/
+
+#ifndef _MOVE_TABLE_HH
+#define _MOVE_TABLE_HH
+
+#include <vector>
+#include <algorithm>
+
+#include <common.hpp>
+
+#include <rle_string.hpp>
+
+#include <mapped_array.hpp>
+
+//! One row per BWT run, with the run where LF maps its first position.
+/*!
+ * A BWT position is represented as a run and an offset in the run. Since LF
+ * maps the positions of a run to consecutive positions, the LF of the offset-th
+ * position of run j is lf_offset[j] + offset positions after the beginning of
+ * lf_run[j], that is found moving forward from lf_run[j] a few runs at most.
+ * The runs are not balanced, so after max_scan runs the move falls back to a
+ * binary search. The samples are indexed by run, so the row index is enough
+ * to reach them.
+ */
+class move_table
+{
+public:
+    static const size_t max_scan = 16; // runs scanned before giving up
+
+    struct row
+    {
+        uint64_t start : 40;     // first BWT position of the run
+        uint64_t head : 8;       // character of the run
+        uint64_t lf_run : 40;    // run containing the LF of start
+        uint64_t lf_offset : 40; // offset of the LF of start in lf_run
+    };
+
+    move_table() {}
+
+    //! Builds the table from the run heads and the 5 bytes run lengths of the BWT.
+    move_table(std::ifstream &heads, std::ifstream &lengths, const std::vector<ulint> &F)
+    {
+        heads.clear();
+        heads.seekg(0);
+        lengths.clear();
+        lengths.seekg(0);
+
+        std::vector<row> rows;
+        std::vector<ulint> starts;
+        std::vector<ulint> lf; // LF of the first position of each run
+        std::vector<ulint> occ(256, 0);
+        int c;
+        ulint n = 0;
+        while ((c = heads.get()) != EOF)
+        {
+            size_t length = 0;
+            lengths.read((char *)&length, 5);
+            if (c <= TERMINATOR) // change 0 to 1
+                c = TERMINATOR;
+
+            rows.push_back(row());
+            rows.back().start = n;
+            rows.back().head = c;
+            starts.push_back(n);
+            lf.push_back(F[c] + occ[c]);
+
+            occ[c] += length;
+            n += length;
+        }
+        const ulint R = rows.size();
+
+        first_runs = std::vector<ulint>(256, R);
+        for (ulint j = R; j-- > 0;)
+            first_runs[rows[j].head] = j;
+
+        for (ulint j = 0; j < R; ++j)
+        {
+            const ulint lf_run = std::upper_bound(starts.begin(), starts.end(), lf[j]) - starts.begin() - 1;
+            rows[j].lf_run = lf_run;
+            rows[j].lf_offset = lf[j] - starts[lf_run];
+        }
+
+        // Sentinel, so that the length of the last run is known
+        rows.push_back(row());
+        rows.back().start = n;
+        rows.back().head = 0;
+        this->rows = mapped_vector<row>(std::move(rows));
+    }
+
+    bool empty() const
+    {
+        return rows.empty();
+    }
+
+    //! Number of runs
+    ulint size() const
+    {
+        return rows.empty() ? 0 : rows.size() - 1;
+    }
+
+    uchar head(const ulint run) const
+    {
+        return rows[run].head;
+    }
+
+    ulint start(const ulint run) const
+    {
+        return rows[run].start;
+    }
+
+    ulint length(const ulint run) const
+    {
+        return rows[run + 1].start - rows[run].start;
+    }
+
+    //! Index of the first run of c, size() if c does not occur
+    ulint first_run(const uchar c) const
+    {
+        return first_runs[c];
+    }
+
+    //! Replaces the offset-th position of run with its LF.
+    void LF(ulint &run, ulint &offset) const
+    {
+        offset += rows[run].lf_offset;
+        run = rows[run].lf_run;
+        for (size_t k = 0; offset >= length(run); ++k)
+        {
+            if (k == max_scan)
+            {
+                const ulint pos = start(run) + offset;
+                run = std::upper_bound(rows.begin(), rows.end() - 1, pos, [](const ulint p, const row &r) { return p < r.start; }) - rows.begin() - 1;
+                offset = pos - start(run);
+                return;
+            }
+            offset -= length(run);
+            ++run;
+        }
+    }
+
+    //! Finds the closest run of c before run, or size() if there is none.
+    //! Returns false if the run is farther than max_scan runs.
+    bool prev_run(const ulint run, const uchar c, ulint &res) const
+    {
+        for (ulint k = 1; k <= max_scan; ++k)
+        {
+            if (run < k)
+            {
+                res = size();
+                return true;
+            }
+            if (rows[run - k].head == c)
+            {
+                res = run - k;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! Finds the closest run of c after run, or size() if there is none.
+    //! Returns false if the run is farther than max_scan runs.
+    bool next_run(const ulint run, const uchar c, ulint &res) const
+    {
+        for (ulint k = 1; k <= max_scan; ++k)
+        {
+            if (run + k >= size())
+            {
+                res = size();
+                return true;
+            }
+            if (rows[run + k].head == c)
+            {
+                res = run + k;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const
+    {
+        sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+        size_t written_bytes = 0;
+
+        written_bytes += rows.serialize(out, child, "rows");
+        written_bytes += my_serialize(first_runs, out, child, "first_runs");
+
+        sdsl::structure_tree::add_size(child, written_bytes);
+        return written_bytes;
+    }
+
+    void load(std::istream &in, const char *mapping = nullptr)
+    {
+        rows.load(in, mapping);
+        my_load(first_runs, in);
+    }
+
+private:
+    mapped_vector<row> rows;
+    std::vector<ulint> first_runs;
+};
+
+#endif /* end of include guard: _MOVE_TABLE_HH */
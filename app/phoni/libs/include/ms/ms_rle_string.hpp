@@ -26,15 +26,71 @@
 
 #include <common.hpp>
 
+#include <sdsl/sd_vector.hpp>
+
 #include <rle_string.hpp>
 
+#include <dna_string.hpp>
+#include <ms_sparse_sd_vector.hpp>
+
+//! Collects the ones of a bitvector, in increasing order, and builds it from its plain bits
+template <class bitvector_t>
+class bitvector_builder
+{
+public:
+    void init(const ulint n, const ulint /* ones */)
+    {
+        bits = vector<bool>(n, false);
+    }
+
+    void set(const ulint i)
+    {
+        bits[i] = true;
+    }
+
+    void build(bitvector_t &bv)
+    {
+        bv = bitvector_t(bits);
+    }
+
+private:
+    vector<bool> bits;
+};
+
+//! ms_sparse_sd_vector is built from its ones, without materializing its bits
+template <>
+class bitvector_builder<ms_sparse_sd_vector>
+{
+public:
+    void init(const ulint n, const ulint ones)
+    {
+        sdsl::sd_vector_builder b(n, ones);
+        builder.swap(b);
+    }
+
+    void set(const ulint i)
+    {
+        builder.set(i);
+    }
+
+    void build(ms_sparse_sd_vector &bv)
+    {
+        bv = ms_sparse_sd_vector(builder);
+    }
+
+private:
+    sdsl::sd_vector_builder builder;
+};
+
 template <
-    class sparse_bitvector_t = ri::sparse_sd_vector, //predecessor structure storing run length
+    class sparse_bitvector_t = ms_sparse_sd_vector, //predecessor structure storing run length
     class string_t = ri::huff_string                 //run heads
     >
 class ms_rle_string : public ri::rle_string<sparse_bitvector_t, string_t>
 {
 public:
+    static const uint64_t alphabet_tag = alphabet_traits<string_t>::tag;
+
     ms_rle_string() : ri::rle_string<sparse_bitvector_t, string_t>()
     {
         //NtD
@@ -65,9 +121,6 @@ public:
         // assert(not contains0(input)); // We're hacking the 0 away :)
         this->B = B;
         // n = input.size();
-        auto runs_per_letter_bv = vector<vector<bool>>(256);
-        //runs in main bitvector
-        vector<bool> runs_bv;
 
         // Reads the run heads
         string run_heads_s;
@@ -76,38 +129,56 @@ public:
         heads.seekg(0, heads.beg);
         heads.read(&run_heads_s[0], run_heads_s.size());
 
-        size_t pos = 0;
         this->n = 0;
         this->R = run_heads_s.size();
-        // Compute runs_bv and runs_per_letter_bv
+        // Reads the run lengths, and counts the occurrences and the runs of each letter
+        std::vector<ulint> run_lengths(this->R);
+        std::vector<ulint> occs(256, 0);
+        std::vector<ulint> runs_of_letter(256, 0);
         for (size_t i = 0; i < run_heads_s.size(); ++i)
         {
-            size_t length;
+            size_t length = 0;
             lengths.read((char *)&length, 5);
             if (run_heads_s[i] <= TERMINATOR) // change 0 to 1
                 run_heads_s[i] = TERMINATOR;
 
-            std::fill_n(std::back_inserter(runs_bv), length - 1, false);
-            runs_bv.push_back(i % B == B - 1);
+            const uchar c = run_heads_s[i];
+            run_lengths[i] = length;
+            occs[c] += length;
+            runs_of_letter[c]++;
+            this->n += length;
+        }
 
-            std::fill_n(std::back_inserter(runs_per_letter_bv[run_heads_s[i]]), length - 1, false);
-            runs_per_letter_bv[run_heads_s[i]].push_back(true);
+        // The bitvectors are built from the positions of their ones, without
+        // materializing their n bits when they are ms_sparse_sd_vector. The main
+        // bitvector marks the end of every B-th run, and the bitvector of c the
+        // end of each run of c.
+        bitvector_builder<sparse_bitvector_t> runs_builder;
+        runs_builder.init(this->n + 1, this->R / B);
+        std::vector<bitvector_builder<sparse_bitvector_t>> runs_per_letter_builder(256);
+        for (ulint c = 0; c < 256; ++c)
+            if (occs[c] > 0)
+                runs_per_letter_builder[c].init(occs[c], runs_of_letter[c]);
 
-            this->n += length;
+        ulint pos = 0;
+        std::fill(occs.begin(), occs.end(), 0);
+        for (size_t i = 0; i < run_heads_s.size(); ++i)
+        {
+            const uchar c = run_heads_s[i];
+            pos += run_lengths[i];
+            occs[c] += run_lengths[i];
+            if (i % B == B - 1)
+                runs_builder.set(pos - 1);
+            runs_per_letter_builder[c].set(occs[c] - 1);
         }
-        runs_bv.push_back(false);
 
         //now compact structures
-        assert(runs_bv.size() == this->n+1);
-        ulint t = 0;
-        for (ulint i = 0; i < 256; ++i)
-            t += runs_per_letter_bv[i].size();
-        assert(t == this->n);
-        this->runs = sparse_bitvector_t(runs_bv);
+        runs_builder.build(this->runs);
         //a fast direct array: char -> bitvector.
         this->runs_per_letter = vector<sparse_bitvector_t>(256);
         for (ulint i = 0; i < 256; ++i)
-            this->runs_per_letter[i] = sparse_bitvector_t(runs_per_letter_bv[i]);
+            if (runs_of_letter[i] > 0)
+                runs_per_letter_builder[i].build(this->runs_per_letter[i]);
         this->run_heads = string_t(run_heads_s);
         assert(this->run_heads.size() == this->R);
     }
@@ -122,6 +193,75 @@ public:
         return this->runs_per_letter[c].size();
     }
 
+    //! What the matching statistics need to know about position i and character c
+    struct locate_t
+    {
+        bool match;     // i < n and the i-th character is c
+        ulint run;      // run of position i, R if i = n
+        ulint rank;     // number of c before position i
+        ulint prev_run; // run of the last c before position i, if !match and rank > 0
+        ulint next_run; // run of the first c after position i, if !match and rank < number_of_letter(c)
+    };
+
+    /*
+     * Fuses access, rank and the predecessor and successor runs of c, scanning the runs once
+     * \param i position in the string, i <= n
+     * \param c character occurring in the string
+     */
+    locate_t locate(const ulint i, const uchar c)
+    {
+        locate_t res;
+        const ulint runs_of_c = this->runs_per_letter[c].rank(this->runs_per_letter[c].size()); // number_of_1() is not in every bitvector
+        ulint rk;       // number of c-runs before the run of i
+        ulint tail = 0; // number of c before i in the run of i
+        if (i == this->n)
+        {
+            res.match = false;
+            res.run = this->R;
+            rk = runs_of_c;
+        }
+        else
+        {
+            // Same scan as rank and run_of_position, keeping the offset in the run
+            ulint last_block = this->runs.rank(i);
+            ulint current_run = last_block * this->B;
+            ulint pos = 0;
+            if (last_block > 0)
+                pos = this->runs.select(last_block - 1) + 1;
+            ulint dist = i - pos;
+            while (pos < i)
+            {
+                pos += this->run_at(current_run);
+                current_run++;
+                if (pos <= i)
+                    dist = i - pos;
+            }
+            if (pos > i)
+                current_run--;
+            assert(current_run < this->R);
+
+            res.run = current_run;
+            res.match = (this->run_heads[current_run] == c);
+            rk = this->run_heads.rank(current_run, c);
+            tail = res.match * dist;
+        }
+        res.rank = (rk == 0 ? 0 : this->runs_per_letter[c].select(rk - 1) + 1) + tail;
+        if (!res.match)
+        {
+            if (rk > 0)
+                res.prev_run = this->run_heads.select(rk - 1, c);
+            if (rk < runs_of_c)
+                res.next_run = this->run_heads.select(rk, c);
+        }
+        return res;
+    }
+
+    //! Returns the index of the i-th run of c among all the runs
+    ulint select_run(const ulint i, const uchar c)
+    {
+        return this->run_heads.select(i, c);
+    }
+
     /* serialize the structure to the ostream
      * \param out     the ostream
      */
@@ -137,11 +277,10 @@ public:
     {
         ri::rle_string<sparse_bitvector_t, string_t>::load(in);
     }
-
-private:
 };
 
-typedef ms_rle_string<ri::sparse_sd_vector> ms_rle_string_sd;
+typedef ms_rle_string<ms_sparse_sd_vector> ms_rle_string_sd;
 typedef ms_rle_string<ri::sparse_hyb_vector> ms_rle_string_hyb;
+typedef ms_rle_string<ms_sparse_sd_vector, dna_string> ms_rle_string_dna;
 
 #endif /* end of include guard: _MS_RLE_STRING_HH */
@@ -0,0 +1,152 @@
+/* ms_sparse_sd_vector - The r-index sparse_sd_vector, also built from the positions of its ones
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file ms_sparse_sd_vector.hpp
+   \brief ms_sparse_sd_vector.hpp The r-index sparse_sd_vector, also built from the positions of its ones.
+*/
+
+#ifndef _MS_SPARSE_SD_VECTOR_HH
+#define _MS_SPARSE_SD_VECTOR_HH
+
+#include <vector>
+
+#include <common.hpp>
+
+#include <sdsl/sd_vector.hpp>
+
+//! Drop-in replacement of ri::sparse_sd_vector that can be built from an sdsl::sd_vector_builder.
+/*!
+ * ri::sparse_sd_vector can only be built from its plain bits, and keeps its
+ * sd_vector private. This class owns the sd_vector instead, so that it can be
+ * moved in from a builder without materializing the bits.
+ */
+class ms_sparse_sd_vector
+{
+public:
+    ms_sparse_sd_vector() {}
+
+    ms_sparse_sd_vector(std::vector<bool> &b)
+    {
+        sdsl::bit_vector bv(b.size());
+        for (size_t i = 0; i < b.size(); ++i)
+            bv[i] = b[i];
+        sdv = sdsl::sd_vector<>(bv);
+        init_support();
+    }
+
+    //! Takes the ones set in builder, which must have set all of them
+    ms_sparse_sd_vector(sdsl::sd_vector_builder &builder) : sdv(builder)
+    {
+        init_support();
+    }
+
+    ms_sparse_sd_vector(const ms_sparse_sd_vector &other) : sdv(other.sdv)
+    {
+        init_support();
+    }
+
+    ms_sparse_sd_vector(ms_sparse_sd_vector &&other) : sdv(std::move(other.sdv))
+    {
+        init_support();
+    }
+
+    ms_sparse_sd_vector &operator=(ms_sparse_sd_vector other)
+    {
+        sdv = std::move(other.sdv);
+        init_support();
+        return *this;
+    }
+
+    bool at(const ulint i) const
+    {
+        return sdv[i];
+    }
+
+    bool operator[](const ulint i) const
+    {
+        return sdv[i];
+    }
+
+    //! Number of ones before position i
+    ulint rank(const ulint i) const
+    {
+        return rank1(i);
+    }
+
+    //! Position of the i-th one, starting from 0
+    ulint select(const ulint i) const
+    {
+        return select1(i + 1);
+    }
+
+    //! Position of the last one up to position i
+    ulint predecessor(const ulint i) const
+    {
+        return select(rank(i + 1) - 1);
+    }
+
+    //! Distance between the i-th one and the previous one, or the beginning
+    ulint gapAt(const ulint i) const
+    {
+        return i == 0 ? select(0) + 1 : select(i) - select(i - 1);
+    }
+
+    ulint size() const
+    {
+        return sdv.size();
+    }
+
+    ulint number_of_1() const
+    {
+        return ones;
+    }
+
+    //! Same layout as ri::sparse_sd_vector: the size, then the sd_vector if it is not empty
+    ulint serialize(std::ostream &out) const
+    {
+        const ulint u = sdv.size();
+        out.write((char *)&u, sizeof(u));
+        if (u == 0)
+            return sizeof(u);
+        return sizeof(u) + sdv.serialize(out);
+    }
+
+    void load(std::istream &in)
+    {
+        ulint u = 0;
+        in.read((char *)&u, sizeof(u));
+        sdv = sdsl::sd_vector<>();
+        if (u > 0)
+            sdv.load(in);
+        init_support();
+    }
+
+private:
+    sdsl::sd_vector<> sdv;
+    sdsl::sd_vector<>::rank_1_type rank1;
+    sdsl::sd_vector<>::select_1_type select1;
+    ulint ones = 0;
+
+    void init_support()
+    {
+        rank1 = sdsl::sd_vector<>::rank_1_type(&sdv);
+        select1 = sdsl::sd_vector<>::select_1_type(&sdv);
+        ones = sdv.size() > 0 ? rank1(sdv.size()) : 0; // rank asserts on an empty sd_vector
+    }
+};
+
+#endif /* end of include guard: _MS_SPARSE_SD_VECTOR_HH */
@@ -26,7 +26,6 @@
 
 
 /** FLAGS **/
-#define MEASURE_TIME 1  //measure the time for LCE and backward search?
 #define NAIVE_LCE_SCHEDULE //stupidly execute two LCEs without heurstics
 #ifndef NAIVE_LCE_SCHEDULE //apply a heuristic
 //#define SORT_BY_DISTANCE_HEURISTIC 1 // apply a heuristic to compute the LCE with the closer BWT position first
@@ -66,7 +65,12 @@
 #endif /* DCHECK_HPP */
 
 
+#include <string_view>
+#include <numeric>
+#include <algorithm>
+
 #include <common.hpp>
+#include <mapped_file.hpp>
 
 #include <malloc_count.h>
 
@@ -76,6 +80,13 @@
 #include <r_index.hpp>
 
 #include<ms_rle_string.hpp>
+#include <slp_cursor.hpp>
+#include <run_snippets.hpp>
+#include <move_table.hpp>
+#include <mapped_array.hpp>
+#include <query_stats.hpp>
+#include <query_trace.hpp>
+#include <thread_pool.hpp>
 
 #include "PlainSlp.hpp"
 #include "PoSlp.hpp"
@@ -90,20 +101,6 @@
 #include "SelectType.hpp"
 #include "VlcVec.hpp"
 
-#ifdef MEASURE_TIME
-struct Stopwatch {
-	std::chrono::high_resolution_clock::time_point m_val = std::chrono::high_resolution_clock::now();
-
-	void reset() {
-		m_val = std::chrono::high_resolution_clock::now();
-	}
-	double seconds() const { 
-		return std::chrono::duration<double, std::ratio<1>>(std::chrono::high_resolution_clock::now() - m_val).count();
-	}
-
-};
-#endif//MEASURE_TIME
-
 using var_t = uint32_t;
 using Fblc = FixedBitLenCode<>;
 using SelSd = SelectSdvec<>;
@@ -114,6 +111,19 @@ using Vlc64 = VlcVec<sdsl::coder::elias_delta, 64>;
 using Vlc128 = VlcVec<sdsl::coder::elias_delta, 128>;
 
 
+//! The first word of the .phoni file, with the alphabet tag in the low bits
+static const uint64_t phoni_header_flag = uint64_t(1) << 63;
+
+//! Returns the alphabet tag of the index in the stream, without consuming it
+inline uint64_t read_phoni_alphabet(std::istream &in)
+{
+    const auto start = in.tellg();
+    uint64_t header = 0;
+    in.read((char *)&header, sizeof(header));
+    in.seekg(start);
+    return (header & phoni_header_flag) ? (header & ~phoni_header_flag) : 0;
+}
+
 template <class sparse_bv_type = ri::sparse_sd_vector,
           class rle_string_t = ms_rle_string_sd,
           class SlpT = SelfShapedSlp<var_t, DagcSd, DagcSd, SelSd>
@@ -126,9 +136,13 @@ public:
     SlpT slp;
 
     // std::vector<ulint> samples_start;
-    int_vector<> samples_start;
+    packed_array samples_start;
+    run_snippets snippets; //! optional, empty unless build_snippets is called
+    move_table moves; //! optional, empty unless build_move_table is called
+    packed_array thresholds; //! optional, empty unless build_thresholds is called
     // int_vector<> samples_end;
     // std::vector<ulint> samples_last;
+    packed_array samples_last; //! hides the int_vector of ri::r_index, so that it can point into the mapping
 
     // static const uchar TERMINATOR = 1;
     // bool sais = true;
@@ -144,6 +158,9 @@ public:
 
     typedef size_t size_type;
 
+    //! Tags of the optional sections of the serialized index
+    enum section_t : uint64_t { snippets_section = 1, move_table_section = 2, thresholds_section = 3 };
+
     ms_pointers()
         : ri::r_index<sparse_bv_type, rle_string_t>()
         {}
@@ -193,8 +210,13 @@ public:
 
 
 
-        read_samples(filename + ".ssa", this->r, log_n, samples_start);
-        read_samples(filename + ".esa", this->r, log_n, this->samples_last);
+        {
+            int_vector<> samples;
+            read_samples(filename + ".ssa", this->r, log_n, samples);
+            samples_start = packed_array(samples);
+            read_samples(filename + ".esa", this->r, log_n, samples);
+            samples_last = packed_array(samples);
+        }
 
 
         std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
@@ -210,12 +232,139 @@ public:
     }
   
 
+    // Stores the k characters following each sample, to compute the short LCEs without the grammar
+    // The grammar must be loaded
+    void build_snippets(const size_t k)
+    {
+        verbose("Building the run snippets");
+        std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+
+        snippets = run_snippets(slp, this->F, this->bwt.size(), samples_start, this->samples_last, k);
+
+        std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+        verbose("Snippet length: ", snippets.length());
+        verbose("Memory peak: ", malloc_count_peak());
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+    }
+
+    // Stores the move table of the BWT runs, to take the backward steps without rank and select
+    void build_move_table(const std::string& filename)
+    {
+        verbose("Building the move table");
+        std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+
+        std::ifstream ifs_heads(filename + ".bwt.heads");
+        std::ifstream ifs_len(filename + ".bwt.len");
+        moves = move_table(ifs_heads, ifs_len, this->F);
+        DCHECK_EQ(moves.size(), this->r);
+
+        std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+        verbose("Memory peak: ", malloc_count_peak());
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+    }
+
+    // Computes the threshold of each run, the first BWT position of minimum LCP between the last c of
+    // the preceding run of c and the run, as MONI defines them, with LCE queries on the samples of the
+    // runs in between. The runs are split among the threads in chunks. The grammar must be loaded
+    void build_thresholds(const std::string& filename, const size_t threads = 1)
+    {
+        verbose("Computing the thresholds");
+        std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+
+        std::vector<ulint> starts;
+        std::vector<uchar> heads;
+        {
+            std::ifstream ifs_heads(filename + ".bwt.heads");
+            std::ifstream ifs_len(filename + ".bwt.len");
+            if (!ifs_heads.is_open() || !ifs_len.is_open())
+                error("open() file " + filename + ".bwt.heads or .bwt.len failed");
+            int c;
+            ulint n = 0;
+            while ((c = ifs_heads.get()) != EOF)
+            {
+                size_t length = 0;
+                ifs_len.read((char *)&length, 5);
+                starts.push_back(n);
+                heads.push_back(c <= TERMINATOR ? TERMINATOR : c);
+                n += length;
+            }
+            starts.push_back(n); //! Sentinel, so that the end of the last run is known
+            if (heads.size() != this->r || n != this->bwt.size())
+                error("invalid files " + filename + ".bwt.heads and .bwt.len: they do not match the index");
+        }
+
+        //! The chunks are multiples of 64 runs, so that no two threads write the same word
+        int_vector<> thr(this->r, 0, bitsize(uint64_t(this->bwt.size())));
+        work_stealing_pool pool(threads);
+        std::vector<size_t> lf_steps(pool.size(), 0), max_lf_steps(pool.size(), 0);
+        pool.parallel_for(this->r, 64 * 64, [&](const size_t i, const size_t thread_id) {
+            const uchar c = heads[i];
+            const ulint rank = this->bwt.rank(starts[i], c);
+            if (rank == 0)
+                return; //! The first run of c has threshold 0
+            const ulint last = this->bwt.select(rank - 1, c);
+            const ulint run_of_last = run_of(starts, last);
+            const ulint textpos_last = suffix_of(heads, run_of_last, this->samples_last[run_of_last]);
+            const ulint lcp = suffix_lce(textpos_last, suffix_of(heads, i, samples_start[i]));
+            size_t steps = 0;
+            thr[i] = first_minimum(starts, heads, last, textpos_last, starts[i], lcp, steps);
+            lf_steps[thread_id] += steps;
+            max_lf_steps[thread_id] = std::max(max_lf_steps[thread_id], steps);
+        });
+        thresholds = packed_array(thr);
+
+        std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+        verbose("Number of threads: ", pool.size());
+        verbose("LF steps inside the runs: ", std::accumulate(lf_steps.begin(), lf_steps.end(), size_t(0)),
+                ", at most ", *std::max_element(max_lf_steps.begin(), max_lf_steps.end()), " for a run");
+        verbose("Thresholds size (bytes): ", (thresholds.size() * thresholds.width() + 7) / 8);
+        verbose("Memory peak: ", malloc_count_peak());
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+    }
+
+    // Caches the expansions of the grammar variables visited most often by the LCE queries, that start
+    // right after the samples, within budget bytes. The grammar must be loaded
+    void build_hot_cache(const size_t budget)
+    {
+        verbose("Building the hot variable cache");
+        std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+
+        std::vector<uint64_t> profile;
+        const size_t step = std::max<size_t>(1, samples_start.size() / (1 << 16));
+        for (size_t i = 0; i < samples_start.size(); i += step)
+        {
+            profile.push_back(samples_start[i] + 1);
+            profile.push_back(this->samples_last[i] + 1);
+        }
+        slp.makeHotCache(budget, profile);
+
+        std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+        verbose("Hot variables: ", slp.getHotCacheSize().first);
+        verbose("Hot cache size (bytes): ", slp.getHotCacheSize().second);
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+    }
+
+    // Computes the Karp-Rabin fingerprints of the grammar, to answer the LCE queries by binary search
+    // The grammar must be loaded
+    void build_fingerprints()
+    {
+        verbose("Building the grammar fingerprints");
+        std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+
+        slp.makeFingerprints();
+
+        std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+        verbose("Memory peak: ", malloc_count_peak());
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+    }
+
     void load_grammar(const std::string& filename) {
         {
             verbose("Load Grammar");
             std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
 
-            ifstream fs(filename + ".slp");
+            const mapped_file file(filename + ".slp");
+            mapped_istream fs(file);
             slp.load(fs);
 
             std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
@@ -268,233 +417,516 @@ public:
       os.write(reinterpret_cast<const char*>(&i), sizeof(size_t));
     }
 
-    // Computes the matching statistics pointers for the given pattern
-    //std::pair<std::vector<size_t>, std::vector<size_t>> 
+    // Computes the matching statistics lengths and pointers for the given pattern
+    // and writes them *backwards* as 8-byte integers into len_filename and ref_filename
     size_t query(const std::string& patternfile, const std::string& len_filename, const std::string& ref_filename) {
 
       const char* p;
       size_t m;
       map_file(patternfile.c_str(), p, m);
 
-        auto pattern_at = [&] (const size_t pos) {
-          return p[pos];
-        };
+      ofstream len_file(len_filename, std::ios::binary);
+      ofstream ref_file(ref_filename, std::ios::binary);
 
-        // ifstream p(patternfile);
-        // p.seekg(0,ios_base::end);
-        // const size_t m = p.tellg();
-        //
-        // auto pattern_at = [&] (const size_t pos) {
-        //   p.seekg(pos, ios_base::beg);
-        //   return p.get();
-        // };
+      query(std::string_view(p, m), [&] (const size_t, const size_t len, const size_t ref) {
+          write_int(len_file, len);
+          write_int(ref_file, ref);
+      });
 
+      munmap((void*)p, m);
+      return m;
+    }
 
-        ofstream len_file(len_filename, std::ios::binary);
-        ofstream ref_file(ref_filename, std::ios::binary);
+    // Computes the matching statistics lengths and pointers for the given pattern
+    // lengths[i] and pointers[i] are the length and the text position of the longest prefix of pattern[i..] occurring in the text
+    size_t query(std::string_view pattern, std::vector<size_t>& lengths, std::vector<size_t>& pointers) {
+      lengths.resize(pattern.size());
+      pointers.resize(pattern.size());
+      return query(pattern, [&] (const size_t i, const size_t len, const size_t ref) {
+          lengths[i] = len;
+          pointers[i] = ref;
+      });
+    }
 
-        const size_t n = slp.getLen();
-        verbose("pattern length: ", m);
-        
-        size_t last_len;
-        size_t last_ref;
+    // Computes the matching statistics lengths and pointers for the given pattern
+    // sink(i, len, ref) is called for each position i of the pattern, from the last one to the first one
+    // The statistics of the query are added to stats, and its primitive calls to trace, if given
+    // With pointers_only, the thresholds choose the pointers without any LCE, and len is only a lower
+    // bound of the length, which recover_lengths computes from the pointers
+    template <typename Sink>
+    size_t query(std::string_view pattern, Sink&& sink, query_stats* stats = nullptr, query_trace* trace = nullptr, const bool pointers_only = false) {
+        verbose("pattern length: ", pattern.size());
+        check_pointers_only(pointers_only);
+
+        query_state s(pattern, slp);
+        s.trace = trace;
+        s.pointers_only = pointers_only;
+        while (!s.done()) {
+            locate(s, sink);
+            if (s.mismatch)
+                resolve(s, sink);
+        }
 
-        auto write_len = [&] (const size_t i) { 
-          last_len = i;
-          write_int(len_file, last_len);
-        };
-        auto write_ref = [&] (const size_t i) { 
-          last_ref = i;
-          write_int(ref_file, last_ref);
+        if (stats != nullptr)
+            stats->merge(s.stats);
+        return pattern.size();
+    }
+
+    // Computes the matching statistics lengths and pointers for all the given patterns,
+    // advancing them in lockstep so that the memory accesses of different patterns overlap
+    // sink(k, i, len, ref) is called for each position i of the k-th pattern, from the last one to the first one
+    // The statistics of the queries are added to stats, and their primitive calls to trace, if given
+    // pointers_only is as in query()
+    template <typename Sink>
+    void query_batch(const std::vector<std::string_view>& patterns, Sink&& sink, query_stats* stats = nullptr, query_trace* trace = nullptr, const bool pointers_only = false) {
+        check_pointers_only(pointers_only);
+        std::vector<query_state> states;
+        states.reserve(patterns.size());
+        for (const auto& pattern : patterns) {
+            states.emplace_back(pattern, slp);
+            states.back().trace = trace;
+            states.back().pointers_only = pointers_only;
+        }
+
+        size_t active = states.size();
+        while (active > 0) {
+            //! First pass: consume one character of each pattern, and prefetch the samples of the mismatching ones
+            for (size_t k = 0; k < states.size(); ++k) {
+                if (!states[k].done())
+                    locate(states[k], [&](const size_t i, const size_t len, const size_t ref) { sink(k, i, len, ref); });
+            }
+            //! Second pass: resolve the mismatches, whose samples should be in cache by now
+            active = 0;
+            for (size_t k = 0; k < states.size(); ++k) {
+                if (states[k].mismatch)
+                    resolve(states[k], [&](const size_t i, const size_t len, const size_t ref) { sink(k, i, len, ref); });
+                active += !states[k].done();
+            }
+        }
+
+        if (stats != nullptr)
+            for (const auto& s : states)
+                stats->merge(s.stats);
+    }
+
+    // Computes the matching statistics lengths and pointers of a long pattern with the threads of pool
+    // The pattern is cut into chunks of chunk_size characters, each one queried from its right end as if
+    // the pattern ended there. Then, from the right, each chunk is repaired by continuing the query of
+    // the chunk on its right, until the length and the pointer of a position are equal to those of the
+    // independent query: the lengths further left are then those of the sequential query. The pointers
+    // can differ on ties, where both candidates are valid: the snippets of the independent query do not
+    // see the pattern past its chunk, so their LCEs above last_len can choose the other candidate
+    // The statistics of the query are added to stats, and pointers_only is as in query()
+    void query_parallel(std::string_view pattern, std::vector<size_t>& lengths, std::vector<size_t>& pointers,
+                        work_stealing_pool& pool, const size_t chunk_size, query_stats* stats = nullptr,
+                        const bool pointers_only = false) {
+        verbose("pattern length: ", pattern.size());
+        check_pointers_only(pointers_only);
+        DCHECK_GT(chunk_size, 0);
+        lengths.resize(pattern.size());
+        pointers.resize(pattern.size());
+        auto sink = [&](const size_t i, const size_t len, const size_t ref) {
+            lengths[i] = len;
+            pointers[i] = ref;
         };
 
-        //TODO: we could allocate the file here and store the numbers *backwards* !
-        ON_DEBUG(std::vector<size_t> ms_references(m,0)); //! stores at (m-i)-th entry the text position of the match with pattern[m-i..] when computing the matching statistics of pattern[m-i-1..]
-        ON_DEBUG(std::vector<size_t> ms_lengths(m,1));
-        ON_DEBUG(ms_lengths[m-1] = 1);
-        write_len(1);
+        //! The state of chunk k sees the pattern up to its right end, and stops at its left end
+        const size_t n_chunks = (pattern.size() + chunk_size - 1) / chunk_size;
+        std::vector<query_state> states;
+        states.reserve(n_chunks);
+        for (size_t k = 0; k < n_chunks; ++k) {
+            states.emplace_back(pattern.substr(0, std::min(pattern.size(), (k + 1) * chunk_size)), slp);
+            states.back().pointers_only = pointers_only;
+            states.back().stats.queries = (k + 1 == n_chunks);
+            states.back().stats.characters = states.back().pattern.size() - k * chunk_size;
+        }
+        pool.parallel_for(n_chunks, 1, [&](const size_t k, const size_t) {
+            query_state& s = states[k];
+            while (s.pattern.size() - s.i > k * chunk_size) {
+                locate(s, sink);
+                if (s.mismatch)
+                    resolve(s, sink);
+            }
+        });
+
+        query_stats repairs;
+        for (size_t k = n_chunks; k-- > 1;) {
+            //! The state of chunk k is right: continue it over chunk k - 1
+            query_state s = states[k];
+            s.stats = query_stats();
+            bool converged = false;
+            auto repair = [&](const size_t i, const size_t len, const size_t ref) {
+                converged = lengths[i] == len && pointers[i] == ref;
+                lengths[i] = len;
+                pointers[i] = ref;
+            };
+            while (!converged && s.pattern.size() - s.i > (k - 1) * chunk_size) {
+                locate(s, repair);
+                if (s.mismatch)
+                    resolve(s, repair);
+            }
+            repairs.merge(s.stats);
+            if (!converged) {
+                //! The repair reached the left end of chunk k - 1, whose state is now this one
+                s.stats = states[k - 1].stats;
+                states[k - 1] = s;
+            }
+        }
 
+        if (stats != nullptr) {
+            for (const auto& s : states)
+                stats->merge(s.stats);
+            stats->merge(repairs);
+        }
+    }
 
-        //!todo: we need here a while look in case that we want to support suffixes of the pattern that are not part of the text
-        DCHECK_GT(this->bwt.number_of_letter(pattern_at(m-1)), 0);
+    // Computes the matching statistics lengths of pattern[begin..end) from its pointers, computed by query()
+    // lengths[i] >= lengths[i-1] - 1, with equality when pointers[i] follows pointers[i-1]: only the other
+    // positions extend their match, comparing the pattern with blocks of the text expanded from the grammar
+    // lengths must have the size of pattern, and only lengths[begin..end) is written, so that the
+    // threads can recover disjoint ranges of the same pattern
+    void recover_lengths(std::string_view pattern, const std::vector<size_t>& pointers, std::vector<size_t>& lengths,
+                         const size_t begin = 0, size_t end = std::string_view::npos) const {
+        DCHECK_EQ(pointers.size(), pattern.size());
+        DCHECK_EQ(lengths.size(), pattern.size());
+        end = std::min(end, pattern.size());
+        std::vector<char> block;
+        size_t l = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const size_t ref = pointers[i];
+            if (i == begin || l == 0 || pointers[i - 1] + 1 != ref) {
+                //! The blocks double from 16 characters, as most extensions stop within a few characters
+                for (size_t block_size = 16; i + l < pattern.size() && ref + l < slp.getLen(); block_size *= 2) {
+                    const size_t len = std::min({block_size, pattern.size() - i - l, slp.getLen() - ref - l});
+                    block.resize(len);
+                    slp.expandSubstr(ref + l, len, block.data());
+                    const size_t k = std::mismatch(block.begin(), block.end(), pattern.begin() + i + l).first - block.begin();
+                    l += k;
+                    if (k < len)
+                        break;
+                }
+            }
+            lengths[i] = l;
+            l = (l == 0 ? 0 : (l - 1));
+        }
+    }
 
-        //! Start with the last character
-        auto pos = this->bwt.select(1, pattern_at(m-1));
+    //! State of a query, advanced by one character of the pattern at a time
+    struct query_state
+    {
+        std::string_view pattern;
+        size_t i = 0; //! number of characters already processed, from the end of the pattern
+
+        //! last_len == 0 means that there is no match to extend, e.g., at the beginning of the pattern
+        size_t last_len = 0;
+        size_t last_ref = 0;
+        ri::ulint pos = 0; //! BWT position of the suffix of the text starting at last_ref
+        ri::ulint run = 0, offset = 0; //! pos as a run and an offset in it, used only with the move table
+        slp_cursor<SlpT> cursor; //! grammar path to last_ref, moved only when an LCE is computed
+        run_snippets::window_t window{}; //! packed characters following last_ref, for the run snippets
+
+        //! Candidates of a mismatch, found by locate() and compared by resolve()
+        bool mismatch = false;
+        ri::ulint rank = 0;
+        ri::ulint number_of_runs_of_c = 0;
+        bool has_prev = false, has_next = false;
+        ri::ulint run0 = 0; //! run of the last c preceding pos, if has_prev
+        ri::ulint run1 = 0; //! run of the first c succeeding pos, if has_next
+
+        query_stats stats;
+        query_trace* trace = nullptr; //! records the LF, select and LCE calls, if not null
+        bool pointers_only = false; //! choose the pointers with the thresholds, without computing the lengths
+
+        query_state(std::string_view pattern_, const SlpT& slp_) : pattern(pattern_), cursor(slp_)
         {
-            const ri::ulint run_of_j = this->bwt.run_of_position(pos);
-            ON_DEBUG(ms_references[m-1] = samples_start[run_of_j]);
-            write_ref(samples_start[run_of_j]);
-            DCHECK_EQ(slp.charAt(ms_references[m-1]),  pattern_at(m-1));
+            stats.queries = 1;
+            stats.characters = pattern.size();
         }
-        pos = LF(pos, pattern_at(m-1));
-
-		#ifdef MEASURE_TIME
-		double time_lce = 0;
-		double time_backwardstep = 0;
-		#endif
-
-        for (size_t i = 1; i < m; ++i) {
-            const auto c = pattern_at(m - i - 1);
-            DCHECK_EQ(ms_lengths[m-i], last_len);
-            ON_DEBUG(DCHECK_EQ(ms_references[m-i], last_ref));
-
-			const size_t number_of_runs_of_c = this->bwt.number_of_letter(c);
-            if(number_of_runs_of_c == 0) {
-                ON_DEBUG(ms_lengths[m-i-1] = 0);
-                write_len(0);
-                write_int(len_file, last_len);
-                // std::cout << "2 letter " << c  << " not found for " << (m-i-1) << " : " << ms_lengths[m-i-1] << std::endl;
-                ON_DEBUG(ms_references[m - i - 1] = 1);
-                write_ref(1);
-            } 
-            else if (pos < this->bwt.size() && this->bwt[pos] == c) {
-                DCHECK_NE(i, 0);
-                ON_DEBUG(ms_lengths[m-i-1] = ms_lengths[m-i]+1);
-                write_len(last_len+1);
-                // std::cout << "0 Len for " << (m-i-1) << " : " << ms_lengths[m-i-1] << std::endl;
-
-                DCHECK_GT(ms_references[m - i], 0);
-                ON_DEBUG(ms_references[m - i - 1] = ms_references[m - i]-1);
-                DCHECK_GT(last_ref, 0);
-                write_ref(last_ref-1);
+
+        bool done() const { return i == pattern.size(); }
+
+        ri::uchar next_char() const { return static_cast<ri::uchar>(pattern[pattern.size() - i - 1]); }
+    };
+
+    // Processes the next character of the query. On a mismatch, it only locates the
+    // runs of the two candidate c's and prefetches their samples, leaving s.mismatch set
+    template <typename Sink>
+    void locate(query_state& s, Sink&& sink) {
+        const auto c = s.next_char();
+
+        s.number_of_runs_of_c = this->bwt.number_of_letter(c);
+        if (s.number_of_runs_of_c == 0) {
+            //! c does not occur in the text: the next character starts a new match
+            s.last_len = 0;
+            s.last_ref = 1;
+            sink(s.pattern.size() - s.i - 1, s.last_len, s.last_ref);
+            snippets.push(s.window, c);
+            ++s.i;
+            return;
+        }
+        else if (s.last_len == 0) {
+            //! Start a new match with the first c of the BWT, that is the head of a run
+            const ri::ulint run_of_j = this->bwt.select_run(0, c);
+            DCHECK_EQ(run_of_j, this->bwt.run_of_position(this->bwt.select(0, c)));
+            if (s.trace)
+                s.trace->select(0, c, run_of_j);
+            s.last_len = 1;
+            s.last_ref = samples_start[run_of_j];
+            if (moves.empty()) {
+                s.pos = this->F[c]; //! LF of the first c
             }
             else {
-                const ri::ulint rank = this->bwt.rank(pos, c);
-
-				size_t sa0, sa1;
-
-				if(rank > 0) {
-					sa0 = this->bwt.select(rank-1, c);
-					DCHECK_LT(sa0, pos);
-				}
-				if(rank < number_of_runs_of_c) {
-					sa1 = this->bwt.select(rank, c);
-					DCHECK_GT(sa1, pos);
-				}
-				
-				struct Triplet {
-					size_t sa, ref, len;
-				};
-
-				auto compute_succeeding_lce = [&] () -> Triplet {
-                // if(rank < this->bwt.number_of_letter(c)) { // LCE with the succeeding position
-					DCHECK_LT(rank, number_of_runs_of_c);
-
-					const ri::ulint run1 = this->bwt.run_of_position(sa1);
-
-                    const size_t textposStart = this->samples_start[run1];
-					#ifdef MEASURE_TIME
-					Stopwatch s;
-					#endif
-                    const size_t lenStart = textposStart+1 >= n ? 0 : lceToRBounded(slp, textposStart+1, last_ref, last_len);
-					#ifdef MEASURE_TIME
-					time_lce += s.seconds();
-					#endif
-                    // ON_DEBUG(
-                    //         const size_t textposLast = this->samples_last[run1];
-                    //         const size_t lenLast = lceToRBounded(slp, textposLast+1, ms_references[m-i]);
-                    //         DCHECK_GT(lenStart, lenLast);
-                    // )
-                    const size_t ref1 = textposStart;
-                    const size_t len1 = lenStart;
-					return {sa1, ref1, len1};
-                };
-
-				auto compute_preceding_lce = [&] () -> Triplet {
-                // if(rank > 0) { // LCE with the preceding position
-					DCHECK_GT(rank, 0);
-
-					const ri::ulint run0 = this->bwt.run_of_position(sa0);
-
-                    const size_t textposLast = this->samples_last[run0];
-					#ifdef MEASURE_TIME
-					Stopwatch s;
-					#endif
-                    const size_t lenLast = textposLast+1 >= n ? 0 : lceToRBounded(slp, textposLast+1, last_ref, last_len);
-					#ifdef MEASURE_TIME
-					time_lce += s.seconds();
-					#endif
-                    // ON_DEBUG( //sanity check
-                    //         const size_t textposStart = this->samples_start[run0];
-                    //         const size_t lenStart = lceToRBounded(slp, textposStart+1, ms_references[m-i], ms_lengths[m-1]);
-                    //         DCHECK_LE(lenStart, lenLast);
-                    // )
-                    const size_t ref0 = textposLast;
-                    const size_t len0 = lenLast;
-					return {sa0, ref0, len0};
-                };
-
-				const Triplet c = [&] () -> Triplet {
-					if(rank == 0) {
-						return compute_succeeding_lce();
-					}
-					else if(rank >= number_of_runs_of_c) {
-						return compute_preceding_lce();
-					}
+                DCHECK_EQ(run_of_j, moves.first_run(c));
+                s.run = run_of_j;
+                s.offset = 0;
+                move_LF(s);
+            }
+            advance(s, c, sink);
+            return;
+        }
+
+        const uint64_t lf_start = s.stats.lf_time.start();
+        if (!moves.empty()) {
+            const bool match = moves.head(s.run) == c;
+            const bool found = match ||
+                (moves.prev_run(s.run, c, s.run0) && moves.next_run(s.run, c, s.run1));
+            if (match) {
+                ++s.stats.matches;
+                DCHECK_GT(s.last_ref, 0);
+                s.last_len = s.last_len + 1;
+                s.last_ref = s.last_ref - 1;
+                const ri::ulint pos = s.pos;
+                move_LF(s); //! Perform one backward step
+                s.stats.lf_time.stop(lf_start);
+                if (s.trace)
+                    s.trace->lf(pos, c, s.pos);
+                advance(s, c, sink);
+                return;
+            }
+            if (found) {
+                s.stats.lf_time.stop(lf_start);
+                s.has_prev = s.run0 < moves.size();
+                s.has_next = s.run1 < moves.size();
+                locate_candidates(s, c);
+                return;
+            }
+            //! The candidate runs are too far away: fall back to the run-length encoded BWT
+        }
+        const auto loc = this->bwt.locate(s.pos, c);
+        s.stats.lf_time.stop(lf_start);
+        DCHECK_EQ(loc.rank, this->bwt.rank(s.pos, c));
+        s.rank = loc.rank;
+        if (s.trace)
+            s.trace->lf(s.pos, c, this->F[c] + s.rank);
+        if (loc.match) {
+            ++s.stats.matches;
+            DCHECK_GT(s.last_ref, 0);
+            s.last_len = s.last_len + 1;
+            s.last_ref = s.last_ref - 1;
+            s.pos = this->F[c] + s.rank; //! Perform one backward step
+            advance(s, c, sink);
+            return;
+        }
+        s.has_prev = s.rank > 0;
+        s.has_next = s.rank < s.number_of_runs_of_c;
+        s.run0 = loc.prev_run;
+        s.run1 = loc.next_run;
+        if (s.trace && s.has_prev)
+            s.trace->select(s.rank - 1, c, s.run0);
+        if (s.trace && s.has_next)
+            s.trace->select(s.rank, c, s.run1);
+        locate_candidates(s, c);
+    }
+
+    // Checks that the thresholds needed by the pointer-only mode are in the index
+    void check_pointers_only(const bool pointers_only) const {
+        if (pointers_only && thresholds.empty())
+            error("the pointer-only mode needs the thresholds of build_phoni -g");
+    }
+
+    // Checks and prefetches the candidate runs of a mismatch
+    void locate_candidates(query_state& s, const ri::uchar c) {
+        if (s.has_prev) {
+            DCHECK_EQ(s.run0, this->bwt.run_of_position(this->bwt.select(this->bwt.rank(s.pos, c) - 1, c)));
+            prefetch(this->samples_last, s.run0);
+        }
+        if (s.has_next) {
+            DCHECK_EQ(s.run1, this->bwt.run_of_position(this->bwt.select(this->bwt.rank(s.pos, c), c)));
+            prefetch(samples_start, s.run1);
+        }
+        DCHECK(s.has_prev || s.has_next);
+        s.mismatch = true;
+        ++s.stats.mismatches;
+    }
+
+    // LCE of T[p..] and T[s.last_ref..] up to s.last_len, computed on the grammar
+    size_t grammar_lce(query_state& s, const size_t p) {
+        if (p >= slp.getLen())
+            return 0;
+        const uint64_t nodes = slpVisitedNodes();
+        const uint64_t start = s.stats.lce_time.start();
+        const size_t len = s.cursor.lce(p, s.last_ref, s.last_len);
+        s.stats.add_lce(len, s.stats.lce_time.stop(start), slpVisitedNodes() - nodes);
+        if (s.trace)
+            s.trace->lce(p, s.last_ref, s.last_len, len);
+        return len;
+    }
+
+    // LCEs of T[p1..] and T[p2..] with T[s.last_ref..] up to s.last_len, computed with one traversal of the grammar,
+    // that counts in the statistics as one LCE of the longer length
+    std::pair<size_t, size_t> grammar_lce2(query_state& s, const size_t p1, const size_t p2) {
+        const uint64_t nodes = slpVisitedNodes();
+        const uint64_t start = s.stats.lce_time.start();
+        const std::pair<size_t, size_t> lens = s.cursor.lce2(p1, p2, s.last_ref, s.last_len);
+        s.stats.add_lce(std::max(lens.first, lens.second), s.stats.lce_time.stop(start), slpVisitedNodes() - nodes);
+        if (s.trace && p1 < slp.getLen())
+            s.trace->lce(p1, s.last_ref, s.last_len, lens.first);
+        if (s.trace && p2 < slp.getLen())
+            s.trace->lce(p2, s.last_ref, s.last_len, lens.second);
+        return lens;
+    }
+
+    // Completes the mismatch step located by locate(), keeping the candidate with the longest LCE with last_ref
+    template <typename Sink>
+    void resolve(query_state& s, Sink&& sink) {
+        DCHECK(s.mismatch);
+        const auto c = s.next_char();
+
+        //! preceding tells whether the candidate is the last c preceding pos or the first c succeeding it
+        struct Triplet {
+            bool preceding;
+            size_t ref, len;
+        };
+
+        auto compute_succeeding_lce = [&] () -> Triplet {
+            DCHECK(s.has_next);
+
+            const size_t textposStart = this->samples_start[s.run1];
+            size_t lenStart = snippets.lce(s.window, false, s.run1, textposStart);
+            if (!snippets.resolved(lenStart, s.last_len))
+                lenStart = grammar_lce(s, textposStart+1);
+            else
+                ++s.stats.snippet_hits;
+            return {false, textposStart, lenStart};
+        };
+
+        auto compute_preceding_lce = [&] () -> Triplet {
+            DCHECK(s.has_prev);
+
+            const size_t textposLast = this->samples_last[s.run0];
+            size_t lenLast = snippets.lce(s.window, true, s.run0, textposLast);
+            if (!snippets.resolved(lenLast, s.last_len))
+                lenLast = grammar_lce(s, textposLast+1);
+            else
+                ++s.stats.snippet_hits;
+            return {true, textposLast, lenLast};
+        };
+
+        const Triplet t = [&] () -> Triplet {
+            if (s.pointers_only) {
+                //! No LCE: the length starts again from the mismatching character
+                const bool preceding = !s.has_next || (s.has_prev && s.pos < thresholds[s.run1]);
+                return {preceding, preceding ? size_t(this->samples_last[s.run0]) : size_t(samples_start[s.run1]), 0};
+            }
+            if(!s.has_prev) {
+                return compute_succeeding_lce();
+            }
+            else if(!s.has_next) {
+                return compute_preceding_lce();
+            }
+            if (!thresholds.empty()) {
+                //! The suffixes of the BWT positions before the threshold of the run of the next c share
+                //! a longer prefix with the preceding c than with the next one: a single LCE is needed
+                return s.pos < thresholds[s.run1] ? compute_preceding_lce() : compute_succeeding_lce();
+            }
 #ifdef NAIVE_LCE_SCHEDULE 
-					{
-						const Triplet a = compute_preceding_lce();
-						const Triplet b = compute_succeeding_lce();
-						if(a.len < b.len) { return b; }
-						return a;
-					}
+            {
+                //! Both LCEs are needed: compute them with a single traversal of the path to last_ref
+                const size_t textposLast = this->samples_last[s.run0];
+                const size_t textposStart = this->samples_start[s.run1];
+                std::pair<size_t, size_t> lens = {snippets.lce(s.window, true, s.run0, textposLast), snippets.lce(s.window, false, s.run1, textposStart)};
+                const bool resolvedLast = snippets.resolved(lens.first, s.last_len);
+                const bool resolvedStart = snippets.resolved(lens.second, s.last_len);
+                s.stats.snippet_hits += resolvedLast + resolvedStart;
+                if (!resolvedLast && !resolvedStart)
+                    lens = grammar_lce2(s, textposLast+1, textposStart+1);
+                else if (!resolvedLast)
+                    lens.first = grammar_lce(s, textposLast+1);
+                else if (!resolvedStart)
+                    lens.second = grammar_lce(s, textposStart+1);
+                const Triplet a = {true, textposLast, lens.first};
+                const Triplet b = {false, textposStart, lens.second};
+                if(a.len < b.len) { return b; }
+                return a;
+            }
 #else //NAIVE_LCE_SCHEDULE
 #ifdef SORT_BY_DISTANCE_HEURISTIC
-					if(pos - sa0 > sa1 - pos) {
+            const ri::ulint rank = this->bwt.rank(s.pos, c);
+            if(s.pos - this->bwt.select(rank - 1, c) > this->bwt.select(rank, c) - s.pos) {
 #else
-					if(true) {
+            if(true) {
 #endif//SORT_BY_DISTANCE_HEURISTIC
-						auto eval_first = &compute_preceding_lce;
-						auto eval_second = &compute_succeeding_lce;
-						const Triplet a = (*eval_first)();
-						if(last_len <= a.len) {
-							return a;
-						} 
-						const Triplet b = (*eval_second)();
-						if(b.len > a.len) { return b; }
-						return a;
-					} 
-					auto eval_first = &compute_succeeding_lce;
-					auto eval_second = &compute_preceding_lce;
-					const Triplet a = (*eval_first)();
-					if(last_len <= a.len) {
-						return a;
-					} 
-					const Triplet b = (*eval_second)();
-					if(b.len > a.len) { return b; }
-					return a;
+                auto eval_first = &compute_preceding_lce;
+                auto eval_second = &compute_succeeding_lce;
+                const Triplet a = (*eval_first)();
+                if(s.last_len <= a.len) {
+                    return a;
+                } 
+                const Triplet b = (*eval_second)();
+                if(b.len > a.len) { return b; }
+                return a;
+            } 
+            auto eval_first = &compute_succeeding_lce;
+            auto eval_second = &compute_preceding_lce;
+            const Triplet a = (*eval_first)();
+            if(s.last_len <= a.len) {
+                return a;
+            } 
+            const Triplet b = (*eval_second)();
+            if(b.len > a.len) { return b; }
+            return a;
 #endif //NAIVE_LCE_SCHEDULE
-				}();
-
-                // if(len0 < len1) {
-                //     len0 = len1;
-                //     ref0 = ref1;
-                //     sa0 = sa1;
-                // }
-                    
-				DCHECK_GT(c.ref, 0);
-                ON_DEBUG(ms_lengths[m-i-1] = 1 + std::min(ms_lengths[m-i], c.len));
-                write_len(1 + std::min(last_len, c.len));
-                ON_DEBUG(ms_references[m-i-1] = c.ref);
-                write_ref(c.ref);
-                pos = c.sa;
-
-                DCHECK_GT(ms_lengths[m-i-1], 0);
-                // std::cout << "1 Len for " << (m-i-1) << " : " << ms_lengths[m-i-1] << " with LCE " << std::max(len1,len0) << std::endl;
-            }
-			#ifdef MEASURE_TIME
-			Stopwatch s;
-			#endif
-            pos = LF(pos, c); //! Perform one backward step
-			#ifdef MEASURE_TIME
-			time_backwardstep += s.seconds();
-			#endif
+        }();
+
+        DCHECK_GT(t.ref, 0);
+        s.last_len = 1 + std::min(s.last_len, t.len);
+        s.last_ref = t.ref;
+        s.mismatch = false;
+
+        //! Perform one backward step from the chosen c
+        if (moves.empty()) {
+            s.pos = this->F[c] + s.rank - t.preceding;
         }
-		#ifdef MEASURE_TIME
-		cout << "Time backwardsearch: " << time_backwardstep << std::endl;
-		cout << "Time lce: " << time_lce << std::endl;
-		#endif
-        return m;
+        else {
+            s.run = t.preceding ? s.run0 : s.run1;
+            s.offset = t.preceding ? moves.length(s.run) - 1 : 0;
+            move_LF(s);
+        }
+        advance(s, c, sink);
+    }
+
+    // Reports the match of the current character, once s.pos has taken the backward step
+    template <typename Sink>
+    void advance(query_state& s, const ri::uchar c, Sink&& sink) {
+        DCHECK_EQ(static_cast<ri::uchar>(slp.charAt(s.last_ref)), c);
+        sink(s.pattern.size() - s.i - 1, s.last_len, s.last_ref);
+        snippets.push(s.window, c);
+        ++s.i;
+    }
+
+    // Performs one backward step of the position s.run, s.offset with the move table, and updates s.pos
+    void move_LF(query_state& s) {
+        ON_DEBUG(const ri::uchar c = moves.head(s.run));
+        ON_DEBUG(const ri::ulint lf = this->F[c] + this->bwt.rank(moves.start(s.run) + s.offset, c));
+        moves.LF(s.run, s.offset);
+        s.pos = moves.start(s.run) + s.offset;
+        DCHECK_EQ(s.pos, lf);
+    }
+
+    // Brings into cache the word of v holding v[i]
+    template <class vector_t>
+    static void prefetch(const vector_t& v, const size_t i) {
+        __builtin_prefetch(v.data() + ((i * v.width()) >> 6));
     }
 
     /*
@@ -522,13 +954,28 @@ public:
         sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
         size_type written_bytes = 0;
 
+        const uint64_t header = phoni_header_flag | rle_string_t::alphabet_tag;
+        written_bytes += sdsl::write_member(header, out);
         out.write((char *)&this->terminator_position, sizeof(this->terminator_position));
         written_bytes += sizeof(this->terminator_position);
         written_bytes += my_serialize(this->F, out, child, "F");
         written_bytes += this->bwt.serialize(out);
-        written_bytes += this->samples_last.serialize(out);
+        written_bytes += samples_last.serialize(out, child, "samples_last");
 
         written_bytes += samples_start.serialize(out, child, "samples_start");
+        //! Optional sections, each one preceded by its tag
+        if (!snippets.empty()) {
+            written_bytes += sdsl::write_member(uint64_t(snippets_section), out);
+            written_bytes += snippets.serialize(out, child, "snippets");
+        }
+        if (!moves.empty()) {
+            written_bytes += sdsl::write_member(uint64_t(move_table_section), out);
+            written_bytes += moves.serialize(out, child, "moves");
+        }
+        if (!thresholds.empty()) {
+            written_bytes += sdsl::write_member(uint64_t(thresholds_section), out);
+            written_bytes += thresholds.serialize(out, child, "thresholds");
+        }
 
         sdsl::structure_tree::add_size(child, written_bytes);
         return written_bytes;
@@ -537,19 +984,64 @@ public:
 
     /* load the structure from the istream
      * \param in the istream
+     * \param mapping the memory read by in if it is a mapped_istream, so that the aligned arrays point into it
      */
-    void load(std::istream &in, const std::string& filename)
+    void load(std::istream &in, const std::string& filename, const char* mapping = nullptr)
     {
-        in.read((char *)&this->terminator_position, sizeof(this->terminator_position));
+        uint64_t header;
+        in.read((char *)&header, sizeof(header));
+        //! Indices without the header start with the terminator position, and use the generic alphabet
+        const uint64_t alphabet = (header & phoni_header_flag) ? (header & ~phoni_header_flag) : 0;
+        if (alphabet != rle_string_t::alphabet_tag)
+            error("the index was built for a different alphabet");
+        if (header & phoni_header_flag)
+            in.read((char *)&this->terminator_position, sizeof(this->terminator_position));
+        else
+            this->terminator_position = header;
         my_load(this->F, in);
         this->bwt.load(in);
         this->r = this->bwt.number_of_runs();
-        this->samples_last.load(in);
-        this->samples_start.load(in);
+        if (header & phoni_header_flag) {
+            samples_last.load(in, mapping);
+            samples_start.load(in, mapping);
+        }
+        else {
+            int_vector<> samples;
+            samples.load(in);
+            samples_last = packed_array(samples);
+            samples.load(in);
+            samples_start = packed_array(samples);
+        }
+        //! Optional sections, up to the end of the file
+        while (in.peek() != EOF) {
+            uint64_t section;
+            sdsl::read_member(section, in);
+            if (section == snippets_section)
+                snippets.load(in, mapping);
+            else if (section == move_table_section)
+                moves.load(in, mapping);
+            else if (section == thresholds_section)
+                thresholds.load(in, mapping);
+            else
+                error("unknown section ", section, " in the index");
+        }
         
         load_grammar(filename);
     }
 
+    /* load the structure mapping filename.phoni in memory
+     * The samples and the optional sections are not copied, they point into
+     * the mapping, which is shared with the other processes mapping the index.
+     * F, the run-length BWT and the grammar are still deserialized into
+     * private copies, so loading them stays linear in their size.
+     */
+    void load_mapped(const std::string& filename)
+    {
+        index_file = mapped_file(filename + ".phoni");
+        mapped_istream in(index_file);
+        load(in, filename, index_file.data());
+    }
+
     // // From r-index
     // ulint get_last_run_sample()
     // {
@@ -571,7 +1063,7 @@ public:
           ulint i = 0;
           while ((c = heads.get()) != EOF)
           {
-            size_t length;
+            size_t length = 0;
             lengths.read((char *)&length, 5);
             if (c > TERMINATOR)
               this->F[c] += length;
@@ -590,6 +1082,91 @@ public:
             this->F[i] += this->F[i - 1];
         return this->F;
     }
+
+    private :
+
+    // Index of the run containing the BWT position pos, given the starts of the runs
+    static ulint run_of(const std::vector<ulint>& starts, const ulint pos)
+    {
+        return std::upper_bound(starts.begin(), starts.end(), pos) - starts.begin() - 1;
+    }
+
+    // Text position of the suffix of a sample of run, which stores the position preceding it
+    // except in the run of the terminator, whose suffix is the whole text
+    static ulint suffix_of(const std::vector<uchar>& heads, const ulint run, const ulint sample)
+    {
+        return heads[run] == TERMINATOR ? 0 : sample + 1;
+    }
+
+    // LCE of the suffixes of the text starting at p1 and p2, 0 if either is the terminator
+    size_t suffix_lce(const ulint p1, const ulint p2) const
+    {
+        if (p1 >= slp.getLen() || p2 >= slp.getLen())
+            return 0;
+        return lceToR(slp, p1, p2);
+    }
+
+    // First BWT position p in (x, y] whose suffix shares exactly lcp characters with T[textpos_x..],
+    // where lcp is the minimum LCP in (x, y] and textpos_x is the suffix of x. Adds to lf_steps the
+    // steps taken while (x, y] lies in one run, at most the LCP of the threshold
+    ulint first_minimum(const std::vector<ulint>& starts, const std::vector<uchar>& heads,
+                        ulint x, ulint textpos_x, ulint y, size_t lcp, size_t& lf_steps)
+    {
+        //! x at the first step, while x and y are moved by LF
+        ulint base = x;
+        while (true)
+        {
+            const ulint run_x = run_of(starts, x);
+            const ulint run_y = run_of(starts, y);
+            if (run_x == run_y)
+            {
+                //! The suffixes in [x, y] are preceded by the same character: follow them one step back,
+                //! where they stay contiguous and share one more character with the suffix of x
+                const uchar c = heads[run_x];
+                const ulint width = y - x;
+                x = this->F[c] + this->bwt.rank(x, c);
+                y = x + width;
+                --textpos_x;
+                ++lcp;
+                ++lf_steps;
+                continue;
+            }
+
+            //! The LCEs with the suffix of x do not increase along the BWT: search the first run
+            //! in (run_x, run_y] whose head reaches the minimum
+            ulint lo = run_x + 1, hi = run_y + 1;
+            while (lo < hi)
+            {
+                const ulint mid = lo + (hi - lo) / 2;
+                if (suffix_lce(textpos_x, suffix_of(heads, mid, samples_start[mid])) > lcp)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo > run_y)
+            {
+                //! The minimum is after the head of the run of y
+                base += starts[run_y] - x;
+                textpos_x = suffix_of(heads, run_y, samples_start[run_y]);
+                x = starts[run_y];
+                continue;
+            }
+            const ulint end = starts[lo] - 1;
+            if (end == x || suffix_lce(textpos_x, suffix_of(heads, lo - 1, this->samples_last[lo - 1])) > lcp)
+                return base + starts[lo] - x;
+
+            //! The minimum is inside the run preceding the head
+            if (lo - 1 > run_x)
+            {
+                base += starts[lo - 1] - x;
+                textpos_x = suffix_of(heads, lo - 1, samples_start[lo - 1]);
+                x = starts[lo - 1];
+            }
+            y = end;
+        }
+    }
+
+    mapped_file index_file; //! the .phoni file, when loaded by load_mapped
     };
 
 #endif /* end of include guard: _MS_POINTERS_HH */
@@ -0,0 +1,276 @@
+/* query_stats - Statistics of the matching statistics queries
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file query_stats.hpp
+   \brief query_stats.hpp Statistics of the matching statistics queries.
+*/
+
+#ifndef _QUERY_STATS_HH
+#define _QUERY_STATS_HH
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <common.hpp>
+
+//! Reads the time stamp counter, or a steady clock in nanoseconds where there is none.
+inline uint64_t read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//! Rate of read_cycles(), measured once against the steady clock.
+inline double cycles_per_second()
+{
+    static const double rate = [] {
+        const auto t0 = std::chrono::steady_clock::now();
+        const uint64_t c0 = read_cycles();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const uint64_t c1 = read_cycles();
+        const auto t1 = std::chrono::steady_clock::now();
+        return (c1 - c0) / std::chrono::duration<double>(t1 - t0).count();
+    }();
+    return rate;
+}
+
+//! Number of values in power of 2 buckets: bucket b counts the values of bit width b.
+struct log2_histogram
+{
+    static const size_t buckets = 65;
+
+    std::array<uint64_t, buckets> counts{};
+
+    void add(const uint64_t v)
+    {
+        ++counts[v == 0 ? 0 : 64 - __builtin_clzll(v)];
+    }
+
+    void merge(const log2_histogram &other)
+    {
+        for (size_t b = 0; b < buckets; ++b)
+            counts[b] += other.counts[b];
+    }
+
+    //! Number of buckets up to the last non-empty one
+    size_t used() const
+    {
+        size_t n = buckets;
+        while (n > 0 && counts[n - 1] == 0)
+            --n;
+        return n;
+    }
+};
+
+//! Duration of an event that happens too often to be timed every time.
+/*!
+ * Only one in 2^sample_shift events reads the cycle counter, and the total is
+ * estimated from the sampled ones, so that timing does not cost more than the
+ * timed work. The counter is read only if MEASURE_TIME is defined at compile
+ * time; otherwise the events are just counted.
+ */
+struct sampled_timer
+{
+    static const uint64_t sample_shift = 6;
+
+    uint64_t events = 0;
+    uint64_t samples = 0;
+    uint64_t cycles = 0; //! sum of the sampled durations
+
+    //! Returns the start of the event if it is sampled, 0 otherwise.
+    uint64_t start()
+    {
+#ifdef MEASURE_TIME
+        return (events++ & ((uint64_t(1) << sample_shift) - 1)) == 0 ? read_cycles() : 0;
+#else
+        ++events;
+        return 0;
+#endif
+    }
+
+    //! Returns the duration of the event if it is sampled, 0 otherwise.
+    uint64_t stop(const uint64_t start)
+    {
+        if (start == 0)
+            return 0;
+        const uint64_t duration = read_cycles() - start;
+        cycles += duration;
+        ++samples;
+        return duration;
+    }
+
+    //! Estimated cycles of all the events
+    double estimate() const
+    {
+        return samples == 0 ? 0 : double(cycles) * events / samples;
+    }
+
+    void merge(const sampled_timer &other)
+    {
+        events += other.events;
+        samples += other.samples;
+        cycles += other.cycles;
+    }
+};
+
+//! Counters of the work done by the queries, collected on the hot path.
+struct query_stats
+{
+    uint64_t queries = 0;
+    uint64_t characters = 0;
+    uint64_t matches = 0;       //! characters extending the match with a backward step only
+    uint64_t mismatches = 0;    //! characters choosing between the two closest candidates
+    uint64_t snippet_hits = 0;  //! LCEs answered by the run snippets
+    uint64_t lce_calls = 0;     //! traversals of the grammar computing LCEs, one for the two LCEs of a mismatch
+    uint64_t lce_length = 0;    //! sum of the lengths of the traversals, the longer LCE for two LCEs
+    uint64_t grammar_nodes = 0; //! grammar nodes visited by the LCEs, on paths or by fingerprint descents
+    sampled_timer lf_time;      //! backward steps
+    sampled_timer lce_time;     //! traversals of the grammar computing LCEs
+    log2_histogram lce_lengths;
+    log2_histogram lce_cycles; //! of the sampled traversals
+
+    //! Records a traversal of the grammar of the given length, with the duration returned by lce_time.stop()
+    void add_lce(const uint64_t length, const uint64_t cycles, const uint64_t nodes)
+    {
+        ++lce_calls;
+        lce_length += length;
+        grammar_nodes += nodes;
+        lce_lengths.add(length);
+        if (cycles > 0)
+            lce_cycles.add(cycles);
+    }
+
+    void merge(const query_stats &other)
+    {
+        queries += other.queries;
+        characters += other.characters;
+        matches += other.matches;
+        mismatches += other.mismatches;
+        snippet_hits += other.snippet_hits;
+        lce_calls += other.lce_calls;
+        lce_length += other.lce_length;
+        grammar_nodes += other.grammar_nodes;
+        lf_time.merge(other.lf_time);
+        lce_time.merge(other.lce_time);
+        lce_lengths.merge(other.lce_lengths);
+        lce_cycles.merge(other.lce_cycles);
+    }
+
+    void write_json(std::ostream &out) const
+    {
+        out << "{\"queries\": " << queries
+            << ", \"characters\": " << characters
+            << ", \"matches\": " << matches
+            << ", \"mismatches\": " << mismatches
+            << ", \"snippet_hits\": " << snippet_hits
+            << ", \"lce_calls\": " << lce_calls
+            << ", \"lce_length\": " << lce_length
+            << ", \"grammar_nodes\": " << grammar_nodes
+            << ", \"lf_steps\": " << lf_time.events
+            << ", \"lce_length_log2_histogram\": ";
+        write_json(out, lce_lengths);
+#ifdef MEASURE_TIME
+        const double rate = cycles_per_second();
+        out << ", \"lf_seconds\": " << lf_time.estimate() / rate
+            << ", \"lce_seconds\": " << lce_time.estimate() / rate
+            << ", \"lce_cycles_log2_histogram\": ";
+        write_json(out, lce_cycles);
+#endif
+        out << "}";
+    }
+
+    //! One metric,bucket,value row per counter and per histogram bucket, prefixed by name
+    void write_csv(std::ostream &out, const std::string &name) const
+    {
+        out << name << ",queries,," << queries << "\n"
+            << name << ",characters,," << characters << "\n"
+            << name << ",matches,," << matches << "\n"
+            << name << ",mismatches,," << mismatches << "\n"
+            << name << ",snippet_hits,," << snippet_hits << "\n"
+            << name << ",lce_calls,," << lce_calls << "\n"
+            << name << ",lce_length,," << lce_length << "\n"
+            << name << ",grammar_nodes,," << grammar_nodes << "\n"
+            << name << ",lf_steps,," << lf_time.events << "\n";
+        for (size_t b = 0; b < lce_lengths.used(); ++b)
+            out << name << ",lce_length_log2_histogram," << b << "," << lce_lengths.counts[b] << "\n";
+#ifdef MEASURE_TIME
+        const double rate = cycles_per_second();
+        out << name << ",lf_seconds,," << lf_time.estimate() / rate << "\n"
+            << name << ",lce_seconds,," << lce_time.estimate() / rate << "\n";
+        for (size_t b = 0; b < lce_cycles.used(); ++b)
+            out << name << ",lce_cycles_log2_histogram," << b << "," << lce_cycles.counts[b] << "\n";
+#endif
+    }
+
+private:
+    static void write_json(std::ostream &out, const log2_histogram &h)
+    {
+        out << "[";
+        for (size_t b = 0; b < h.used(); ++b)
+            out << (b ? ", " : "") << h.counts[b];
+        out << "]";
+    }
+};
+
+//! Writes the statistics of each thread and their total to filename, in CSV if it ends with .csv and in JSON otherwise.
+inline void write_query_stats(const std::string &filename, const std::vector<query_stats> &threads)
+{
+    std::ofstream out(filename);
+    if (!out.is_open())
+        error("open() file " + filename + " failed");
+
+    query_stats total;
+    for (const auto &stats : threads)
+        total.merge(stats);
+
+    const bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+    if (csv)
+    {
+        out << "thread,metric,bucket,value\n";
+        total.write_csv(out, "total");
+        for (size_t t = 0; t < threads.size(); ++t)
+            threads[t].write_csv(out, std::to_string(t));
+    }
+    else
+    {
+        out << "{";
+#ifdef MEASURE_TIME
+        out << "\"cycles_per_second\": " << cycles_per_second() << ",\n";
+#endif
+        out << "\"total\": ";
+        total.write_json(out);
+        out << ",\n\"threads\": [";
+        for (size_t t = 0; t < threads.size(); ++t)
+        {
+            out << (t ? ",\n" : "\n");
+            threads[t].write_json(out);
+        }
+        out << "]}\n";
+    }
+}
+
+#endif /* end of include guard: _QUERY_STATS_HH */
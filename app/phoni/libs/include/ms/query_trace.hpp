@@ -0,0 +1,171 @@
+/* query_trace - Traces of the primitive calls of the matching statistics queries
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file query_trace.hpp
+   \brief query_trace.hpp Traces of the primitive calls of the matching statistics queries.
+*/
+
+#ifndef _QUERY_TRACE_HH
+#define _QUERY_TRACE_HH
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+
+#include <common.hpp>
+#include <mapped_file.hpp>
+
+//! A primitive call of a query and its result.
+struct trace_event
+{
+    enum kind_t : uint8_t
+    {
+        lf_event = 1,     //! result = LF(pos, c) = F[c] + rank(pos, c), with a = pos, b = c
+        select_event = 2, //! result = run_of_position(select(i, c)), with a = i, b = c
+        lce_event = 3     //! result = LCE of T[p..] and T[ref..] up to upperbound, with a = p, b = ref, c = upperbound
+    };
+
+    kind_t kind;
+    uint64_t a = 0, b = 0, c = 0;
+    uint64_t result = 0;
+};
+
+//! First bytes of a trace file, followed by the events
+static const std::string trace_magic = "PHONITR1";
+
+//! Events recorded by one thread, encoded as a tag byte followed by the fields as LEB128 varints.
+/*!
+ * The results are stored with the calls, so that a replay can verify them
+ * against another encoding of the same text. Positions take 5 bytes or less,
+ * characters and most LCE lengths one or two.
+ */
+struct query_trace
+{
+    std::string buffer;
+
+    void lf(const uint64_t pos, const uint8_t c, const uint64_t result)
+    {
+        put(trace_event::lf_event), put(pos), put(c), put(result);
+    }
+
+    void select(const uint64_t i, const uint8_t c, const uint64_t result)
+    {
+        put(trace_event::select_event), put(i), put(c), put(result);
+    }
+
+    void lce(const uint64_t p, const uint64_t ref, const uint64_t upperbound, const uint64_t result)
+    {
+        put(trace_event::lce_event), put(p), put(ref), put(upperbound), put(result);
+    }
+
+private:
+    void put(uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            buffer += static_cast<char>(v | 0x80);
+            v >>= 7;
+        }
+        buffer += static_cast<char>(v);
+    }
+};
+
+//! Trace file shared by the threads, which append their events in blocks.
+class trace_writer
+{
+public:
+    static const size_t block_size = 1 << 24; //! bytes buffered by a thread before appending them
+
+    trace_writer(const std::string &filename) : out(filename, std::ios::binary)
+    {
+        if (!out.is_open())
+            error("open() file " + filename + " failed");
+        out.write(trace_magic.data(), trace_magic.size());
+    }
+
+    //! Appends the events of trace if it holds at least min_size bytes, and clears it.
+    void append(query_trace &trace, const size_t min_size = 0)
+    {
+        if (trace.buffer.empty() || trace.buffer.size() < min_size)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        out.write(trace.buffer.data(), trace.buffer.size());
+        trace.buffer.clear();
+    }
+
+private:
+    std::ofstream out;
+    std::mutex mutex;
+};
+
+//! Reads the events of a trace file, in the order they were appended.
+class trace_reader
+{
+public:
+    trace_reader(const std::string &filename) : file(filename)
+    {
+        if (file.size() < trace_magic.size() || std::string(file.data(), trace_magic.size()) != trace_magic)
+            error("invalid trace file " + filename);
+        p = file.data() + trace_magic.size();
+    }
+
+    //! Reads the next event into e, returns false at the end of the trace.
+    bool next(trace_event &e)
+    {
+        if (p == file.data() + file.size())
+            return false;
+        e.kind = static_cast<trace_event::kind_t>(get());
+        e.a = get();
+        e.b = get();
+        e.c = e.kind == trace_event::lce_event ? get() : 0;
+        e.result = get();
+        return true;
+    }
+
+    //! All the events of the given kind
+    std::vector<trace_event> events(const trace_event::kind_t kind)
+    {
+        std::vector<trace_event> events;
+        trace_event e;
+        while (next(e))
+            if (e.kind == kind)
+                events.push_back(e);
+        return events;
+    }
+
+private:
+    mapped_file file;
+    const char *p;
+
+    uint64_t get()
+    {
+        const char *end = file.data() + file.size();
+        uint64_t v = 0;
+        for (int shift = 0; p < end; shift += 7)
+        {
+            const uint8_t byte = *p++;
+            v |= uint64_t(byte & 0x7f) << shift;
+            if (byte < 0x80)
+                return v;
+        }
+        error("truncated trace file");
+        return v;
+    }
+};
+
+#endif /* end of include guard: _QUERY_TRACE_HH */
@@ -0,0 +1,202 @@
+/* run_snippets - Packed text snippets following the run boundary samples
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file run_snippets.hpp
+   \brief run_snippets.hpp Packed text snippets following the run boundary samples.
+*/
+
+#ifndef _RUN_SNIPPETS_HH
+#define _RUN_SNIPPETS_HH
+
+#include <array>
+#include <vector>
+#include <algorithm>
+
+#include <common.hpp>
+
+#include <sdsl/int_vector.hpp>
+
+#include <rle_string.hpp>
+
+#include <mapped_array.hpp>
+
+//! The k characters following each sample of samples_start and samples_last.
+/*!
+ * The LCEs of PHONI always start right after a run boundary sample. Storing
+ * the next k characters of each of them, packed with the bits needed by the
+ * text alphabet, answers every LCE shorter than k with a few word XORs against
+ * a window of the pattern, since the characters following last_ref are the
+ * last_len characters of the pattern already matched. Only the LCEs reaching
+ * k characters have to be computed on the grammar.
+ * The characters are packed from the least significant bits of each word, and
+ * a character never spans two words.
+ */
+class run_snippets
+{
+public:
+    static const size_t max_words = 4; // words of a snippet
+
+    //! The last characters consumed by a query, the most recent one first
+    using window_t = std::array<uint64_t, max_words>;
+
+    run_snippets() {}
+
+    //! Builds the snippets of all the runs, with k = 0 meaning no snippets.
+    /*!
+     * \param F the F column of the BWT, which gives the text alphabet
+     * \param bwt_size the length of the BWT
+     */
+    template <class SlpT, class start_t, class last_t>
+    run_snippets(const SlpT &slp, const std::vector<ulint> &F, const size_t bwt_size,
+                 const start_t &samples_start, const last_t &samples_last, const size_t k_)
+    {
+        n = slp.getLen();
+
+        // Dense codes for the characters of the text
+        codes = std::vector<uint8_t>(256, 0);
+        size_t sigma = 0;
+        for (size_t c = TERMINATOR + 1; c < 256; ++c)
+        {
+            const ulint next = (c < 255) ? F[c + 1] : bwt_size;
+            if (next > F[c])
+                codes[c] = sigma++;
+        }
+        width = std::max<size_t>(1, bitsize(uint64_t(std::max<size_t>(sigma, 2) - 1)));
+        chars_per_word = 64 / width;
+
+        k = std::min(k_, max_words * chars_per_word);
+        if (k < k_)
+        {
+            verbose("Snippet length reduced to ", k);
+        }
+        if (k == 0)
+            return;
+        words = (k + chars_per_word - 1) / chars_per_word;
+        word_mask = (chars_per_word * width == 64) ? ~uint64_t(0) : (uint64_t(1) << (chars_per_word * width)) - 1;
+
+        build_snippets(slp, samples_start, start_snippets);
+        build_snippets(slp, samples_last, last_snippets);
+    }
+
+    bool empty() const
+    {
+        return k == 0;
+    }
+
+    size_t length() const
+    {
+        return k;
+    }
+
+    //! Prepends the character c to the window.
+    void push(window_t &window, const uint8_t c) const
+    {
+        if (words == 0)
+            return;
+        for (size_t i = words - 1; i > 0; --i)
+            window[i] = ((window[i] << width) | (window[i - 1] >> ((chars_per_word - 1) * width))) & word_mask;
+        window[0] = ((window[0] << width) | codes[c]) & word_mask;
+    }
+
+    //! Returns the LCE of T[textpos+1..] and the window, up to k.
+    /*!
+     * \param last whether textpos is samples_last[run] rather than samples_start[run]
+     */
+    size_t lce(const window_t &window, const bool last, const size_t run, const size_t textpos) const
+    {
+        const uint64_t *snippet = (last ? last_snippets : start_snippets).data() + run * words;
+        size_t l = k;
+        for (size_t i = 0; i < words; ++i)
+        {
+            const uint64_t x = snippet[i] ^ window[i];
+            if (x)
+            {
+                l = std::min(k, i * chars_per_word + __builtin_ctzll(x) / width);
+                break;
+            }
+        }
+        return std::min(l, n - std::min(n, textpos + 1));
+    }
+
+    //! Whether an LCE computed by lce() is exact, or at least bound.
+    bool resolved(const size_t l, const size_t bound) const
+    {
+        return l < k || l >= bound;
+    }
+
+    size_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const
+    {
+        sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+        size_t written_bytes = 0;
+
+        written_bytes += sdsl::write_member(k, out, child, "k");
+        written_bytes += sdsl::write_member(n, out, child, "n");
+        written_bytes += sdsl::write_member(width, out, child, "width");
+        written_bytes += my_serialize(codes, out, child, "codes");
+        written_bytes += start_snippets.serialize(out, child, "start_snippets");
+        written_bytes += last_snippets.serialize(out, child, "last_snippets");
+
+        sdsl::structure_tree::add_size(child, written_bytes);
+        return written_bytes;
+    }
+
+    void load(std::istream &in, const char *mapping = nullptr)
+    {
+        sdsl::read_member(k, in);
+        sdsl::read_member(n, in);
+        sdsl::read_member(width, in);
+        my_load(codes, in);
+        start_snippets.load(in, mapping);
+        last_snippets.load(in, mapping);
+
+        chars_per_word = 64 / width;
+        words = (k + chars_per_word - 1) / chars_per_word;
+        word_mask = (chars_per_word * width == 64) ? ~uint64_t(0) : (uint64_t(1) << (chars_per_word * width)) - 1;
+    }
+
+private:
+    template <class SlpT, class samples_t>
+    void build_snippets(const SlpT &slp, const samples_t &samples, mapped_vector<uint64_t> &res)
+    {
+        std::vector<uint64_t> snippets(samples.size() * words, 0);
+        std::vector<char> buffer(k);
+        for (size_t run = 0; run < samples.size(); ++run)
+        {
+            const size_t pos = samples[run] + 1;
+            if (pos >= n)
+                continue;
+            const size_t len = std::min(k, n - pos);
+            slp.expandSubstr(pos, len, buffer.data());
+            for (size_t j = 0; j < len; ++j)
+                snippets[run * words + j / chars_per_word] |= uint64_t(codes[static_cast<uint8_t>(buffer[j])]) << ((j % chars_per_word) * width);
+        }
+        res = mapped_vector<uint64_t>(std::move(snippets));
+    }
+
+    size_t k = 0;     // characters of each snippet
+    size_t n = 0;     // length of the text
+    size_t width = 1; // bits per character
+    size_t chars_per_word = 64;
+    size_t words = 0; // words per snippet
+    uint64_t word_mask = 0;
+    std::vector<uint8_t> codes;
+
+    mapped_vector<uint64_t> start_snippets; // snippets following samples_start
+    mapped_vector<uint64_t> last_snippets;  // snippets following samples_last
+};
+
+#endif /* end of include guard: _RUN_SNIPPETS_HH */
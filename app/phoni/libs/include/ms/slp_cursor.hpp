@@ -0,0 +1,161 @@
+/* slp_cursor - Root-to-node path of an SLP kept alive across LCE queries
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file slp_cursor.hpp
+   \brief slp_cursor.hpp Root-to-node path of an SLP kept alive across LCE queries.
+*/
+
+#ifndef _SLP_CURSOR_HH
+#define _SLP_CURSOR_HH
+
+#include <algorithm>
+#include <vector>
+#include <stack>
+#include <tuple>
+#include <utility>
+
+#include <Common.hpp>
+
+//! Path from the root of an SLP to the highest node starting at a text position.
+/*!
+ * The path is the one built by getPrefixPath, but it is kept across queries
+ * together with the text position where each of its nodes starts. Moving the
+ * cursor to a new position pops the nodes that do not contain it and descends
+ * again only from the lowest one that does, so that nearby positions, like the
+ * consecutive values of last_ref in ms_pointers::query, share most of the path.
+ * If the SLP has Karp-Rabin fingerprints, the LCEs that go past the first
+ * fingerprint_block characters are continued with them.
+ */
+template <class SlpT>
+class slp_cursor
+{
+public:
+    using nodeT = typename SlpT::nodeT;
+    using path_t = SlpPath<nodeT>;
+
+    //! Characters compared through the paths before switching to fingerprints, as most LCEs are shorter
+    static constexpr uint64_t fingerprint_block = 64;
+
+    slp_cursor(const SlpT &slp_) : slp(&slp_) {}
+
+    //! Moves the cursor to the text position pos < slp.getLen().
+    void seek(const uint64_t pos)
+    {
+        position = pos;
+        if (path.empty())
+        {
+            path.push(slp->getRootNode());
+            starts.push_back(0);
+        }
+
+        // Ascend to the lowest node containing pos
+        while (path.size() > 1 && (pos < starts.back() || pos >= starts.back() + std::get<0>(path.top())))
+            pop();
+        // Ascend to the highest node starting at pos, as getPrefixPath would stop there
+        while (path.size() > 1 && starts[starts.size() - 2] == pos)
+            pop();
+
+        // Descend to the highest node starting at pos
+        const size_t depth = path.size();
+        uint64_t rel = pos - starts.back();
+        if (rel && path.size() == 1)
+        {
+            path.push(slp->getChildNodeForPos_Root(rel)); // rel is modified to relative pos in a node
+            starts.push_back(pos - rel);
+        }
+        while (rel)
+        {
+            path.push(slp->getChildNodeForPos(path.top(), rel));
+            starts.push_back(pos - rel);
+        }
+        slpVisitedNodes() += path.size() - depth;
+    }
+
+    //! Returns the length of the longest common prefix of T[p..] and T[pos..], where pos is the last position seeked, up to upperbound.
+    uint64_t lce(const uint64_t p, const uint64_t upperbound)
+    {
+        if (p >= slp->getLen())
+            return 0;
+
+        // lceToRBounded consumes the paths, thus we work on copies that reuse their memory
+        const uint64_t bound = block_bound(upperbound);
+        other.clear();
+        getPrefixPath(*slp, other, p);
+        scratch = path;
+        const uint64_t l = lceToRBounded(*slp, other, scratch, bound);
+        return extend(l, p, bound, upperbound);
+    }
+
+    //! Seeks to pos and returns the LCE of T[p..] and T[pos..], up to upperbound.
+    uint64_t lce(const uint64_t p, const uint64_t pos, const uint64_t upperbound)
+    {
+        seek(pos);
+        return lce(p, upperbound);
+    }
+
+    //! Returns the LCEs of T[p1..] and T[p2..] against T[pos..], where pos is the last position seeked, up to upperbound.
+    /*!
+     * The path to pos is traversed once for both LCEs. Positions past the end of the text give 0.
+     */
+    std::pair<uint64_t, uint64_t> lce2(const uint64_t p1, const uint64_t p2, const uint64_t upperbound)
+    {
+        const uint64_t bound = block_bound(upperbound);
+        other.clear();
+        other2.clear();
+        getPrefixPath(*slp, other, p1);
+        getPrefixPath(*slp, other2, p2);
+        scratch = path;
+        const auto lens = lce2ToRBounded(*slp, other, other2, scratch, bound);
+        return {extend(lens.first, p1, bound, upperbound), extend(lens.second, p2, bound, upperbound)};
+    }
+
+    //! Seeks to pos and returns the LCEs of T[p1..] and T[p2..] against T[pos..], up to upperbound.
+    std::pair<uint64_t, uint64_t> lce2(const uint64_t p1, const uint64_t p2, const uint64_t pos, const uint64_t upperbound)
+    {
+        seek(pos);
+        return lce2(p1, p2, upperbound);
+    }
+
+private:
+    //! Upper bound of the comparison through the paths
+    uint64_t block_bound(const uint64_t upperbound) const
+    {
+        return hasFingerprints(*slp) ? std::min(upperbound, fingerprint_block) : upperbound;
+    }
+
+    //! Continues with fingerprints an LCE l of T[p..] that reached the bound of the paths
+    uint64_t extend(const uint64_t l, const uint64_t p, const uint64_t bound, const uint64_t upperbound) const
+    {
+        if (l < bound || l >= upperbound)
+            return l;
+        return l + fingerprintLce(*slp, p + l, position + l, upperbound - l);
+    }
+
+    void pop()
+    {
+        path.pop();
+        starts.pop_back();
+    }
+
+    const SlpT *slp;
+    path_t path;
+    std::vector<uint64_t> starts; //! starts[i] is the text position of the i-th node of path
+    uint64_t position = 0; //! the last position seeked
+    path_t scratch, other, other2;
+};
+
+#endif /* end of include guard: _SLP_CURSOR_HH */
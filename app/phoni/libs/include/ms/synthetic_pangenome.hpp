@@ -0,0 +1,429 @@
+/* synthetic_pangenome - Deterministic synthetic collections of genomes and reads
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file synthetic_pangenome.hpp
+   \brief synthetic_pangenome.hpp Deterministic synthetic collections of genomes and reads.
+*/
+
+#ifndef _SYNTHETIC_PANGENOME_HH
+#define _SYNTHETIC_PANGENOME_HH
+
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include <divsufsort64.h>
+
+#include <common.hpp>
+
+#include <phoni.hpp>
+
+//! Parameters of a synthetic collection of genomes and of the reads sampled from it
+struct pangenome_params
+{
+    size_t length = 1 << 20;  // of the base sequence
+    size_t copies = 8;        // mutated copies of the base sequence in the collection, besides the base sequence
+    double snp_rate = 1e-3;   // per base
+    double indel_rate = 2e-4; // per base, insertions and deletions alike
+    size_t max_indel = 10;
+    double sv_rate = 1e-5;    // per base: inversions, duplications, transpositions and deletions of segments
+    size_t max_sv = 5000;
+    size_t reads = 1000;
+    size_t read_length = 150;
+    double error_rate = 1e-2; // per base of the reads
+    uint64_t seed = 0;
+};
+
+//! Options setting the pangenome_params, shared by the tools generating collections
+const std::string pangenome_options = "l:c:s:v:i:I:V:X:r:L:e:";
+
+const std::string pangenome_usage =
+    "[-l length] [-c copies] [-s seed] [-v snp] [-i indel] [-I max_indel] [-V sv] [-X max_sv] [-r reads] [-L read_length] [-e errors]";
+
+const std::string pangenome_options_usage =
+    "     length: [integer] - length of the base sequence (def. 1048576)\n"
+    "     copies: [integer] - mutated copies of the base sequence (def. 8)\n"
+    "       seed: [integer] - seed of the generator, equal seeds give equal collections (def. 0)\n"
+    "        snp: [float]   - rate of the substitutions per base (def. 0.001)\n"
+    "      indel: [float]   - rate of the insertions and deletions per base (def. 0.0002)\n"
+    "  max_indel: [integer] - maximum length of the insertions and deletions (def. 10)\n"
+    "         sv: [float]   - rate of the structural rearrangements per base (def. 0.00001)\n"
+    "     max_sv: [integer] - maximum length of the structural rearrangements (def. 5000)\n"
+    "      reads: [integer] - number of simulated reads (def. 1000)\n"
+    "read_length: [integer] - length of the reads (def. 150)\n"
+    "     errors: [float]   - rate of the sequencing errors per base of the reads (def. 0.01)\n";
+
+//! Sets the parameter of option c, returns false if c is not one of pangenome_options.
+inline bool parse_pangenome_option(const int c, const char *arg, pangenome_params &params)
+{
+    switch (c)
+    {
+    case 'l': params.length = std::stoull(arg); break;
+    case 'c': params.copies = std::stoull(arg); break;
+    case 's': params.seed = std::stoull(arg); break;
+    case 'v': params.snp_rate = std::stod(arg); break;
+    case 'i': params.indel_rate = std::stod(arg); break;
+    case 'I': params.max_indel = std::max<size_t>(1, std::stoull(arg)); break;
+    case 'V': params.sv_rate = std::stod(arg); break;
+    case 'X': params.max_sv = std::max<size_t>(1, std::stoull(arg)); break;
+    case 'r': params.reads = std::stoull(arg); break;
+    case 'L': params.read_length = std::max<size_t>(1, std::stoull(arg)); break;
+    case 'e': params.error_rate = std::stod(arg); break;
+    default: return false;
+    }
+    return true;
+}
+
+//! Generator of a collection of DNA sequences and of reads sampled from them.
+/*!
+ * The collection is a random base sequence followed by its copies, each one
+ * derived from the base sequence or from an earlier copy by substitutions,
+ * short insertions and deletions, and structural rearrangements, so that the
+ * copies share their variants along a random phylogeny. Everything is drawn
+ * from a generator seeded with params.seed: a collection is determined by its
+ * parameters, and the collections with more copies extend those with fewer.
+ */
+class pangenome_generator
+{
+public:
+    //! A named sequence, as a FASTA record
+    using record_t = std::pair<std::string, std::string>;
+
+    pangenome_generator(const pangenome_params &params)
+        : params(params), gen(params.seed)
+    {
+    }
+
+    std::vector<record_t> genomes()
+    {
+        std::vector<record_t> genomes;
+        genomes.emplace_back("genome_0", random_sequence(params.length));
+        for (size_t i = 1; i <= params.copies; ++i)
+        {
+            const size_t parent = gen() % genomes.size();
+            genomes.emplace_back("genome_" + std::to_string(i) + "_from_" + std::to_string(parent), mutate(genomes[parent].second));
+        }
+        return genomes;
+    }
+
+    //! Reads from random positions of random genomes, with errors growing along the read
+    /*!
+     * The error rate at offset i of a read grows linearly from half to one and a
+     * half times params.error_rate, as with short-read sequencers, and one error
+     * in ten is an insertion or a deletion instead of a substitution.
+     */
+    std::vector<record_t> reads(const std::vector<record_t> &genomes)
+    {
+        std::vector<record_t> reads;
+        std::uniform_real_distribution<double> uniform;
+        for (size_t k = 0; k < params.reads; ++k)
+        {
+            const size_t g = gen() % genomes.size();
+            const std::string &genome = genomes[g].second;
+            const size_t m = std::min(params.read_length, genome.size());
+            const size_t pos = gen() % (genome.size() - m + 1);
+
+            std::string read;
+            for (size_t i = pos; read.size() < m && i < genome.size();)
+            {
+                const double rate = params.error_rate * (0.5 + double(read.size()) / m);
+                if (uniform(gen) >= rate)
+                    read += genome[i++];
+                else if (gen() % 10 != 0)
+                    read += substitute(genome[i++]);
+                else if (gen() % 2 == 0)
+                    read += random_base(); // insertion
+                else
+                    ++i; // deletion
+            }
+            reads.emplace_back("read_" + std::to_string(k) + "_genome_" + std::to_string(g) + "_pos_" + std::to_string(pos), read);
+        }
+        return reads;
+    }
+
+private:
+    const pangenome_params params;
+    std::mt19937_64 gen;
+
+    char random_base()
+    {
+        return "ACGT"[gen() % 4];
+    }
+
+    //! One of the other three bases
+    char substitute(const char c)
+    {
+        const size_t k = std::string("ACGT").find(c);
+        return k == std::string::npos ? random_base() : "ACGT"[(k + 1 + gen() % 3) % 4];
+    }
+
+    std::string random_sequence(const size_t length)
+    {
+        std::string s(length, 'A');
+        for (auto &c : s)
+            c = random_base();
+        return s;
+    }
+
+    static std::string reverse_complement(const std::string &s)
+    {
+        std::string r(s.rbegin(), s.rend());
+        for (auto &c : r)
+            c = c == 'A' ? 'T' : c == 'C' ? 'G' : c == 'G' ? 'C' : 'A';
+        return r;
+    }
+
+    //! A copy of s, with the events at distances drawn from a geometric distribution
+    std::string mutate(const std::string &s)
+    {
+        const double rate = params.snp_rate + params.indel_rate + params.sv_rate;
+        if (rate <= 0)
+            return s;
+        std::geometric_distribution<size_t> gap(std::min(rate, 1.0));
+        std::uniform_real_distribution<double> uniform(0, rate);
+
+        std::string t;
+        t.reserve(s.size() + s.size() / 8);
+        size_t i = 0;
+        while (true)
+        {
+            const size_t next = i + gap(gen);
+            if (next >= s.size())
+                break;
+            t.append(s, i, next - i);
+            i = next;
+
+            const double event = uniform(gen);
+            if (event < params.snp_rate)
+                t += substitute(s[i++]);
+            else if (event < params.snp_rate + params.indel_rate)
+            {
+                const size_t len = 1 + gen() % params.max_indel;
+                if (gen() % 2 == 0)
+                    t += random_sequence(len);
+                else
+                    i = std::min(s.size(), i + len);
+            }
+            else
+            {
+                size_t len = std::min<size_t>(1 + gen() % params.max_sv, s.size() - i);
+                switch (gen() % 4)
+                {
+                case 0: // inversion
+                    t += reverse_complement(s.substr(i, len));
+                    break;
+                case 1: // tandem duplication
+                    t.append(s, i, len).append(s, i, len);
+                    break;
+                case 2: // transposition of the segment and the following one
+                {
+                    const size_t len2 = std::min(len, s.size() - i - len);
+                    t.append(s, i + len, len2).append(s, i, len);
+                    len += len2;
+                    break;
+                }
+                default: // deletion
+                    break;
+                }
+                i += len;
+            }
+        }
+        t.append(s, i, std::string::npos);
+        return t;
+    }
+};
+
+//******************************************************************************
+// Writers of the generated sequences
+
+inline void write_fasta(const std::string &filename, const std::vector<pangenome_generator::record_t> &records)
+{
+    std::ofstream out(filename);
+    if (!out.is_open())
+        error("open() file " + filename + " failed");
+    for (const auto &record : records)
+    {
+        out << ">" << record.first << "\n";
+        for (size_t i = 0; i < record.second.size(); i += 80)
+            out.write(record.second.data() + i, std::min<size_t>(80, record.second.size() - i)) << "\n";
+    }
+}
+
+//! Writes the patterns in patterns.dir/, one file each and their descriptions in desc.txt, as phoni -p patterns reads them
+inline void write_patterns(const std::string &patterns, const std::vector<pangenome_generator::record_t> &records)
+{
+    const std::string dir = patterns + ".dir/";
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        error("mkdir() " + dir + " failed");
+    std::ofstream desc(dir + "desc.txt");
+    if (!desc.is_open())
+        error("open() file " + dir + "desc.txt failed");
+    for (size_t k = 0; k < records.size(); ++k)
+    {
+        desc << records[k].first << "\n";
+        std::ofstream out(dir + std::to_string(k), std::ios::binary);
+        out.write(records[k].second.data(), records[k].second.size());
+    }
+}
+
+//******************************************************************************
+// In-process construction of the inputs of build_phoni
+
+//! Writes the run-length BWT of text and the samples at the boundaries of its runs
+/*!
+ * The files are those of the prefix-free parsing pipeline: basename.bwt.heads
+ * and basename.bwt.len, with the head and the 5-byte length of each run, and
+ * basename.ssa and basename.esa, with the BWT position and the SA value of the
+ * first and of the last position of each run. The text is terminated by a 0,
+ * so it must not contain the characters 0 and 1. Returns the number of runs.
+ */
+inline size_t build_rlbwt(const std::string &text, const std::string &basename)
+{
+    const size_t n = text.size() + 1;
+    const char *t = text.c_str(); // with the terminator
+    std::vector<saidx64_t> sa(n);
+    if (divsufsort64(reinterpret_cast<const sauchar_t *>(t), sa.data(), n) != 0)
+        error("divsufsort64 failed");
+
+    std::ofstream heads(basename + ".bwt.heads", std::ios::binary);
+    std::ofstream lengths(basename + ".bwt.len", std::ios::binary);
+    std::ofstream ssa(basename + ".ssa", std::ios::binary);
+    std::ofstream esa(basename + ".esa", std::ios::binary);
+    if (!heads.is_open() || !lengths.is_open() || !ssa.is_open() || !esa.is_open())
+        error("open() files " + basename + ".bwt.heads, .bwt.len, .ssa, .esa failed");
+    auto write = [](std::ofstream &out, const uint64_t value, const size_t bytes) {
+        out.write(reinterpret_cast<const char *>(&value), bytes);
+    };
+    auto bwt = [&](const size_t i) { return t[(sa[i] + n - 1) % n]; };
+
+    size_t r = 0;
+    for (size_t start = 0, i = 0; i < n; ++i)
+    {
+        if (i + 1 < n && bwt(i + 1) == bwt(i))
+            continue;
+        heads.put(bwt(i));
+        write(lengths, i + 1 - start, 5);
+        write(ssa, start, SSABYTES);
+        write(ssa, sa[start], SSABYTES);
+        write(esa, i, SSABYTES);
+        write(esa, sa[i], SSABYTES);
+        start = i + 1;
+        ++r;
+    }
+    return r;
+}
+
+//! Grammar of text from a locally consistent parsing, in place of the RePair grammar of the pipeline.
+/*!
+ * Each level cuts the sequence of the previous one before the symbols whose
+ * hash is smaller than the hashes of both neighbours, and every max_block
+ * symbols, and replaces each block with the root of a balanced tree of pairs.
+ * Equal pairs get the same variable and equal substrings are parsed the same
+ * way except near their ends, so that the repeats of the collection share
+ * their variables as with RePair.
+ */
+inline NaiveSlp<var_t> build_grammar(const std::string &text, const uint64_t seed = 0)
+{
+    static const size_t max_block = 16;
+    if (text.size() < 2)
+        error("the text of the grammar must have at least 2 characters");
+
+    NaiveSlp<var_t> slp;
+    std::vector<bool> occurs(256, false);
+    for (const unsigned char c : text)
+        occurs[c] = true;
+    std::vector<var_t> code(256);
+    for (size_t c = 0; c < 256; ++c)
+        if (occurs[c])
+        {
+            code[c] = slp.getAlphSize();
+            slp.setAlphSize(slp.getAlphSize() + 1);
+            slp.setChar(code[c], c);
+        }
+    const uint64_t sigma = slp.getAlphSize();
+
+    std::unordered_map<uint64_t, var_t> pairs;
+    auto pair = [&](const var_t left, const var_t right) {
+        const auto it = pairs.emplace((uint64_t(left) << 32) | right, sigma + slp.getNumRules());
+        if (it.second)
+            slp.pushPair({left, right});
+        return it.first->second;
+    };
+    auto mix = [](uint64_t x) { // splitmix64
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    };
+
+    std::vector<var_t> seq(text.size());
+    for (size_t i = 0; i < text.size(); ++i)
+        seq[i] = code[static_cast<unsigned char>(text[i])];
+
+    std::vector<var_t> next, block;
+    uint64_t level_seed = seed;
+    while (seq.size() > 1)
+    {
+        level_seed = mix(level_seed + 0x9e3779b97f4a7c15ULL);
+        auto hash = [&](const size_t i) { return mix(seq[i] ^ level_seed); };
+
+        next.clear();
+        for (size_t begin = 0, i = 1; i <= seq.size(); ++i)
+        {
+            const bool cut = i == seq.size() or i - begin == max_block or
+                             (i + 1 < seq.size() and hash(i) < hash(i - 1) and hash(i) < hash(i + 1));
+            if (!cut)
+                continue;
+            block.assign(seq.begin() + begin, seq.begin() + i);
+            while (block.size() > 1)
+            {
+                size_t k = 0;
+                for (size_t j = 0; j + 1 < block.size(); j += 2)
+                    block[k++] = pair(block[j], block[j + 1]);
+                if (block.size() % 2 == 1)
+                    block[k++] = block.back();
+                block.resize(k);
+            }
+            next.push_back(block[0]);
+            begin = i;
+        }
+        seq.swap(next);
+    }
+
+    slp.setLenSeq(1);
+    slp.setSeq(0, seq[0]);
+    return slp;
+}
+
+//! Writes basename.slp, the grammar of text encoded as the SLP of PHONI. Returns the number of rules.
+inline size_t build_slp(const std::string &text, const std::string &basename)
+{
+    const NaiveSlp<var_t> grammar = build_grammar(text);
+    SelfShapedSlp<var_t, DagcSd, DagcSd, SelSd> slp(grammar);
+    std::ofstream out(basename + ".slp", std::ios::binary);
+    if (!out.is_open())
+        error("open() file " + basename + ".slp failed");
+    slp.serialize(out);
+    return grammar.getNumRules();
+}
+
+#endif /* end of include guard: _SYNTHETIC_PANGENOME_HH */
@@ -31,6 +31,7 @@
 #include <malloc_count.h>
 
 #include <SelfShapedSlp.hpp>
+#include <SlpIterator.hpp>
 #include <DirectAccessibleGammaCode.hpp>
 #include <SelectType.hpp>
 
@@ -123,7 +124,7 @@ public:
   using SelSd = SelectSdvec<>;
   using DagcSd = DirectAccessibleGammaCode<SelSd>;
 
-  aligner_t(std::string filename, size_t min_len_ = 50) : min_len(min_len_)
+  aligner_t(std::string filename, size_t min_len_ = 50, size_t hot_cache = 0) : min_len(min_len_)
   {
     verbose("Building the matching statistics index");
     std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
@@ -146,6 +147,8 @@ public:
 
     ifstream fs(filename_slp);
     ra.load(fs);
+    if (hot_cache > 0)
+      ra.makeHotCache(hot_cache << 20);
 
     n = ra.getLen();
 
@@ -164,12 +167,12 @@ public:
 
     auto pointers = ms.query(pattern.second);
     std::vector<size_t> lengths(pointers.size());
+    SlpBlockReader<decltype(ra)> reader(ra);
     size_t l = 0;
     for (size_t i = 0; i < pointers.size(); ++i)
     {
       size_t pos = pointers[i];
-      while ((i + l) < pattern.second.size() && (pos + l) < n && pattern.second[i + l] == ra.charAt(pos + l))
-        ++l;
+      l = reader.extendMatch(pos, pattern.second.data() + i, pattern.second.size() - i, l);
 
       lengths[i] = l;
       l = (l == 0 ? 0 : (l - 1));
@@ -254,7 +257,7 @@ main(int argc, char *const argv[])
   verbose("Construction of the aligner");
   std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
 
-  aligner_t aligner(args.filename, 0);
+  aligner_t aligner(args.filename, 0, args.hot_cache);
 
   std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
   verbose("Memory peak: ", malloc_count_peak());
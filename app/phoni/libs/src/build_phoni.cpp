@@ -13,16 +13,23 @@
 typedef std::pair<std::string, std::vector<uint8_t>> pattern_t;
 
 
-int main(int argc, char *const argv[]) {
-  Args args;
-  parseArgs(argc, argv, args);
-
+template <class ms_t>
+void build(const Args &args)
+{
   verbose("Building the phoni index");
   std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
 
 
-  ms_pointers<> ms;
+  ms_t ms;
   ms.build(args.filename);
+  if (args.snippets > 0 || args.thresholds)
+    ms.load_grammar(args.filename);
+  if (args.snippets > 0)
+    ms.build_snippets(args.snippets);
+  if (args.move)
+    ms.build_move_table(args.filename);
+  if (args.thresholds)
+    ms.build_thresholds(args.filename, args.th);
 
   std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
 
@@ -34,6 +41,19 @@ int main(int argc, char *const argv[]) {
   ofstream outfile(args.filename + ".phoni", std::ios::binary);
   ms.serialize(outfile);
   }
+}
+
+int main(int argc, char *const argv[]) {
+  Args args;
+  parseArgs(argc, argv, args);
+
+  if (args.dna)
+  {
+    verbose("Alphabet: ", alphabet_traits<dna_string>::name);
+    build<ms_pointers<ri::sparse_sd_vector, ms_rle_string_dna>>(args);
+  }
+  else
+    build<ms_pointers<>>(args);
 
   return 0;
 }
@@ -0,0 +1,97 @@
+/* gen_pangenome - Generates a synthetic collection of genomes and reads
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file gen_pangenome.cpp
+   \brief gen_pangenome.cpp Generates a synthetic collection of genomes and reads.
+*/
+
+#include <iostream>
+
+#define VERBOSE
+
+#include <common.hpp>
+
+#include <synthetic_pangenome.hpp>
+
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+    std::string usage("usage: " + std::string(argv[0]) + " outfile " + pangenome_usage + " [-x inputs]\n\n" +
+                      "Writes a base sequence and its mutated copies to outfile.fa and their concatenation to outfile,\n" +
+                      "and reads sampled from them to outfile.reads.fa and to outfile.reads.dir, the patterns of phoni -p outfile.reads.\n" +
+                      pangenome_options_usage +
+                      "     inputs: [boolean] - also write the inputs of build_phoni: outfile.bwt.heads, .bwt.len, .ssa, .esa and .slp. (def. false)\n");
+
+    pangenome_params params;
+    bool inputs = false;
+    int c;
+    while ((c = getopt(argc, argv, (pangenome_options + "xh").c_str())) != -1)
+    {
+        if (c == 'x')
+            inputs = true;
+        else if (c == 'h')
+            error(usage);
+        else if (!parse_pangenome_option(c, optarg, params))
+            error("Unknown option.\n", usage);
+    }
+    if (argc != optind + 1)
+        error("Invalid number of arguments\n", usage);
+    const std::string filename = argv[optind];
+
+    verbose("Generating the collection");
+    std::chrono::high_resolution_clock::time_point t_start = std::chrono::high_resolution_clock::now();
+
+    pangenome_generator generator(params);
+    const auto genomes = generator.genomes();
+    const auto reads = generator.reads(genomes);
+
+    std::string text;
+    for (const auto &genome : genomes)
+        text += genome.second;
+
+    write_fasta(filename + ".fa", genomes);
+    {
+        std::ofstream out(filename, std::ios::binary);
+        out.write(text.data(), text.size());
+    }
+    write_fasta(filename + ".reads.fa", reads);
+    write_patterns(filename + ".reads", reads);
+
+    std::chrono::high_resolution_clock::time_point t_end = std::chrono::high_resolution_clock::now();
+    verbose("Genomes: ", genomes.size(), ", total length: ", text.size());
+    verbose("Reads: ", reads.size());
+    verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_end - t_start).count());
+
+    if (inputs)
+    {
+        verbose("Building the RLBWT, the samples and the grammar");
+        t_start = std::chrono::high_resolution_clock::now();
+
+        const size_t r = build_rlbwt(text, filename);
+        const size_t rules = build_slp(text, filename);
+
+        t_end = std::chrono::high_resolution_clock::now();
+        verbose("Number of BWT equal-letter runs: r = ", r);
+        verbose("Rate n/r = ", double(text.size() + 1) / r);
+        verbose("Grammar rules: ", rules);
+        verbose("Memory peak: ", malloc_count_peak());
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_end - t_start).count());
+    }
+
+    return 0;
+}
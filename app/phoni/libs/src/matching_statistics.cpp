@@ -30,54 +30,13 @@
 
 #include <malloc_count.h>
 
+#include <sequence_reader.hpp>
+
 #include <SelfShapedSlp.hpp>
+#include <SlpIterator.hpp>
 #include <DirectAccessibleGammaCode.hpp>
 #include <SelectType.hpp>
 
-typedef std::pair<std::string, std::vector<uint8_t>> pattern_t;
-
-std::vector<pattern_t> read_patterns(std::string filename)
-{
-  // Open File
-  FILE *fd;
-  if ((fd = fopen(filename.c_str(), "r")) == nullptr)
-    error("open() file " + filename + " failed");
-
-  std::vector<pattern_t> patterns;
-
-  pattern_t pattern;
-
-  char c;
-  while (fread(&c, sizeof(char), 1, fd) == 1)
-  {
-    if (c == '>')
-    {
-      if (pattern.second.size() > 0)
-        patterns.push_back(pattern);
-
-      pattern.first.clear();
-      pattern.second.clear();
-
-      pattern.first.append(1, c);
-      while (fread(&c, sizeof(char), 1, fd) == 1 && c != '\n')
-        pattern.first.append(1, c);
-    }
-    else
-    {
-      pattern.second.push_back(c);
-      while (fread(&c, sizeof(char), 1, fd) == 1 && c != '\n')
-        pattern.second.push_back(c);
-    }
-  }
-
-  if (pattern.second.size() > 0)
-    patterns.push_back(pattern);
-
-  fclose(fd);
-
-  return patterns;
-}
-
 int main(int argc, char *const argv[])
 {
   using SelSd = SelectSdvec<>;
@@ -108,8 +67,6 @@ int main(int argc, char *const argv[])
   ifstream fs(filename_slp);
   ra.load(fs);
 
-  size_t n = ra.getLen();
-
   t_insert_end = std::chrono::high_resolution_clock::now();
 
   verbose("Matching statistics index construction complete");
@@ -128,16 +85,6 @@ int main(int argc, char *const argv[])
   // size_t space = ms_size + ra_size;
   // verbose("Total size (bytes): ", space);
 
-  verbose("Reading patterns");
-  t_insert_start = std::chrono::high_resolution_clock::now();
-
-  std::vector<pattern_t> patterns = read_patterns(args.patterns);
-
-  t_insert_end = std::chrono::high_resolution_clock::now();
-
-  verbose("Memory peak: ", malloc_count_peak());
-  verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
-
   verbose("Processing patterns");
   t_insert_start = std::chrono::high_resolution_clock::now();
 
@@ -150,30 +97,37 @@ int main(int argc, char *const argv[])
   if (!f_lengths.is_open())
     error("open() file " + std::string(args.filename) + ".lengths failed");
 
-  for (auto pattern : patterns)
+  SlpBlockReader<decltype(ra)> reader(ra);
+  sequence_reader patterns(args.patterns);
+  sequence_batch batch;
+  std::vector<uint8_t> pattern;
+  while (patterns.next(batch, 1024))
   {
-    auto pointers = ms.query(pattern.second);
-    std::vector<size_t> lengths(pointers.size());
-    size_t l = 0;
-    for (size_t i = 0; i < pointers.size(); ++i)
+    for (size_t k = 0; k < batch.size(); ++k)
     {
-      size_t pos = pointers[i];
-      while ((i + l) < pattern.second.size() && (pos + l) < n && pattern.second[i + l] == ra.charAt(pos + l))
-        ++l;
-
-      lengths[i] = l;
-      l = (l == 0 ? 0 : (l - 1));
+      pattern.assign(batch.sequence(k).begin(), batch.sequence(k).end());
+      auto pointers = ms.query(pattern);
+      std::vector<size_t> lengths(pointers.size());
+      size_t l = 0;
+      for (size_t i = 0; i < pointers.size(); ++i)
+      {
+        size_t pos = pointers[i];
+        l = reader.extendMatch(pos, pattern.data() + i, pattern.size() - i, l);
+
+        lengths[i] = l;
+        l = (l == 0 ? 0 : (l - 1));
+      }
+
+      f_pointers << ">" << batch.name(k) << endl;
+      for (auto elem : pointers)
+        f_pointers << elem << " ";
+      f_pointers << endl;
+
+      f_lengths << ">" << batch.name(k) << endl;
+      for (auto elem : lengths)
+        f_lengths << elem << " ";
+      f_lengths << endl;
     }
-
-    f_pointers << pattern.first << endl;
-    for (auto elem : pointers)
-      f_pointers << elem << " ";
-    f_pointers << endl;
-
-    f_lengths << pattern.first << endl;
-    for (auto elem : lengths)
-      f_lengths << elem << " ";
-    f_lengths << endl;
   }
 
   f_pointers.close();
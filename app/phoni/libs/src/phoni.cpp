@@ -19,6 +19,8 @@
 */
 
 #include <iostream>
+#include <memory>
+#include <future>
 
 #define VERBOSE
 
@@ -28,6 +30,9 @@
 
 #include <phoni.hpp>
 
+#include <thread_pool.hpp>
+#include <sequence_reader.hpp>
+
 #include <malloc_count.h>
 
 
@@ -41,112 +46,269 @@ std::vector<std::string> read_pattern_desc(const std::string& patternpath) {
   return descs;
 }
 
-   inline static void read_int(istream& is, size_t& i){
-      is.read(reinterpret_cast<char*>(&i), sizeof(size_t));
-    }
+// A group of patterns, that views either the arena of a FASTA or FASTQ batch or the mapped files
+// of the pattern directory
+class pattern_group {
+public:
+  size_t size() const { return sequences.size(); }
 
-int main(int argc, char *const argv[]) {
-  Args args;
-  parseArgs(argc, argv, args);
+  std::string_view name(const size_t i) const { return names[i]; }
 
-#ifdef NDEBUG
-  verbose("RELEASE build");
-#else
-  verbose("DEBUG build");
-#endif
-
-  verbose("Memory peak: ", malloc_count_peak());
+  std::string_view sequence(const size_t i) const { return sequences[i]; }
 
-  verbose("Deserializing the PHONI index");
-  std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+  void clear() {
+    batch.clear();
+    files.clear();
+    names.clear();
+    sequences.clear();
+  }
 
+private:
+  friend class pattern_reader;
+
+  sequence_batch batch;
+  std::vector<mapped_file> files;
+  std::vector<std::string_view> names;
+  std::vector<std::string_view> sequences;
+};
+
+// Reads the patterns in groups, from a FASTA or FASTQ file, possibly gzipped, with -f,
+// and otherwise from the files of the pattern directory listed in its desc.txt
+class pattern_reader {
+public:
+  pattern_reader(const Args &args) : patterndir(args.patterns + ".dir/") {
+    if (args.is_fasta)
+      fasta.reset(new sequence_reader(args.patterns));
+    else
+      descs = read_pattern_desc(patterndir);
+  }
 
-  ms_pointers<> ms;
-  {
-    ifstream in(args.filename + ".phoni");
-    ms.load(in, args.filename);
+  // Reads up to max_patterns patterns into group, replacing its content. Returns false if there are none left
+  // The files of the pattern directory stay mapped until the group is cleared, so that nothing is copied
+  bool next(pattern_group &group, const size_t max_patterns) {
+    group.clear();
+    if (fasta) {
+      fasta->next(group.batch, max_patterns);
+      for (size_t i = 0; i < group.batch.size(); ++i) {
+        group.names.push_back(group.batch.name(i));
+        group.sequences.push_back(group.batch.sequence(i));
+      }
+      return group.size() > 0;
+    }
+    for (; group.size() < max_patterns && next_id < descs.size(); ++next_id) {
+      group.files.emplace_back(patterndir + std::to_string(next_id));
+      group.names.push_back(descs[next_id]);
+      group.sequences.push_back(std::string_view(group.files.back().data(), group.files.back().size()));
+    }
+    return group.size() > 0;
   }
 
-  std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+private:
+  const std::string patterndir;
+  std::unique_ptr<sequence_reader> fasta;
+  std::vector<std::string> descs;
+  size_t next_id = 0;
+};
+
+// Writes as 0 the lengths that recover does not ask for: all keeps them all, max keeps those of the
+// positions whose match is not contained in the match of the previous position, and a number is the
+// minimum length kept
+void mask_lengths(const std::string& recover, std::vector<size_t>& lengths) {
+  if (recover == "all")
+    return;
+  if (recover == "max") {
+    for (size_t i = lengths.size(); i-- > 1;)
+      if (lengths[i] < lengths[i - 1])
+        lengths[i] = 0;
+    return;
+  }
+  const size_t min_length = std::stoull(recover);
+  for (auto& len : lengths)
+    if (len < min_length)
+      len = 0;
+}
 
-  verbose("PHONI index construction complete");
-  verbose("Memory peak: ", malloc_count_peak());
-  verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+template <class ms_t>
+void query_patterns(const Args &args)
+{
+  verbose("Deserializing the PHONI index");
+  std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
 
-  verbose("Reading patterns");
-  t_insert_start = std::chrono::high_resolution_clock::now();
-  const std::string patterndir = args.patterns + ".dir/";
 
-  std::vector<std::string> patterndescs = read_pattern_desc(patterndir);
+  ms_t ms;
+  ms.load_mapped(args.filename);
+  if (args.hot_cache > 0)
+    ms.build_hot_cache(args.hot_cache << 20);
+  if (args.fingerprints)
+    ms.build_fingerprints();
 
-  t_insert_end = std::chrono::high_resolution_clock::now();
+  std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
 
+  verbose("PHONI index construction complete");
   verbose("Memory peak: ", malloc_count_peak());
   verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
 
   verbose("Processing patterns");
   t_insert_start = std::chrono::high_resolution_clock::now();
 
+  if (!args.recover.empty() && args.recover != "all" && args.recover != "max" &&
+      args.recover.find_first_not_of("0123456789") != std::string::npos)
+    error("invalid lengths to recover: " + args.recover);
+  // The pointer-only mode writes the lengths only if it recovers them
+  const bool write_lengths = !args.pointers_only || !args.recover.empty();
+
   std::ofstream f_pointers(args.patterns + ".pointers");
-  std::ofstream f_lengths(args.patterns + ".lengths");
+  std::ofstream f_lengths;
+  if (write_lengths)
+    f_lengths.open(args.patterns + ".lengths");
 
   if (!f_pointers.is_open())
     error("open() file " + std::string(args.filename) + ".pointers failed");
 
-  if (!f_lengths.is_open())
+  if (write_lengths && !f_lengths.is_open())
     error("open() file " + std::string(args.filename) + ".lengths failed");
 
-  for(size_t patternid = 0; patternid < patterndescs.size(); ++patternid){
-    const std::string& patterndesc = patterndescs[patternid];
-    verbose("Processing pattern ", patterndesc);
-    f_lengths << ">" << patterndesc << " " << endl;
-    f_pointers << ">" << patterndesc << " " << endl;
-    const std::string patternfilename = patterndir +  std::to_string(patternid);
-    //auto [lengths,refs] = 
-    
-    t_insert_start = std::chrono::high_resolution_clock::now();
-    const size_t patternlength = ms.query(patternfilename, std::string(args.filename) + ".binrev.length",  std::string(args.filename) + ".binrev.pointers");
-    t_insert_end = std::chrono::high_resolution_clock::now();
-    verbose("Finished processing pattern ", patterndesc);
-    verbose("Memory peak: ", malloc_count_peak());
-    verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+  // The formatted lengths and pointers of a pattern, written in input order
+  using result_t = std::pair<std::string, std::string>;
+  auto write_result = [&](const result_t &result) {
+    f_lengths << result.first;
+    f_pointers << result.second;
+  };
+  reorder_buffer<result_t, decltype(write_result)> results(write_result, 64 * args.th * std::max<size_t>(args.batch, 1));
+  auto format_result = [&](const std::string_view patterndesc, const std::vector<size_t> &pattern_lengths, const std::vector<size_t> &pattern_pointers) {
+    result_t result;
+    if (write_lengths)
+      result.first = ">" + std::string(patterndesc) + " \n";
+    result.second = ">" + std::string(patterndesc) + " \n";
+    for(size_t i = 0; i < pattern_pointers.size(); ++i) {
+      if (write_lengths)
+        result.first += std::to_string(pattern_lengths[i]) + " ";
+      result.second += std::to_string(pattern_pointers[i]) + " ";
+    }
+    if (write_lengths)
+      result.first += "\n";
+    result.second += "\n";
+    return result;
+  };
+
+  work_stealing_pool pool(args.th);
+  verbose("Number of threads: ", pool.size());
+
+  verbose("Patterns per batch: ", args.batch);
+
+  // Per-thread scratch space for the matching statistics of a batch
+  std::vector<std::vector<std::vector<size_t>>> lengths(pool.size());
+  std::vector<std::vector<std::vector<size_t>>> pointers(pool.size());
+  std::vector<query_stats> stats(pool.size());
+
+  // Per-thread traces of the primitive calls, appended to the trace file in blocks
+  std::unique_ptr<trace_writer> trace_file;
+  std::vector<query_trace> traces(pool.size());
+  if (!args.trace.empty())
+    trace_file.reset(new trace_writer(args.trace));
+  if (trace_file && args.chunk > 0)
+    error("the queries in chunks cannot be traced");
+
+  // The patterns are read in groups, each one processed by all the threads while the next is read
+  pattern_reader reader(args);
+  pattern_group groups[2];
+  const size_t group_size = args.chunk > 0 ? 1 : 16 * pool.size() * std::max<size_t>(args.batch, 1);
+  if (args.chunk > 0)
+    verbose("Characters per chunk: ", args.chunk);
+
+  bool more = reader.next(groups[0], group_size);
+  for (size_t first_id = 0, current = 0; more; current = 1 - current)
+  {
+    const pattern_group &group = groups[current];
+    std::future<bool> next = std::async(std::launch::async, [&reader, &groups, current, group_size] {
+      return reader.next(groups[1 - current], group_size);
+    });
 
+    if (args.chunk > 0)
     {
-      const size_t* len_file;
-      const size_t* ref_file;
-      size_t len_size;
-      size_t ref_size;
-
-      const std::string len_filename = std::string(args.filename) + ".binrev.length";
-      const std::string ref_filename = std::string(args.filename) + ".binrev.pointers";
-
-      map_file(len_filename.c_str(), len_file, len_size);
-      map_file(ref_filename.c_str(), ref_file, ref_size);
-
-      // ifstream len_file(std::string(args.filename) + ".binrev.length", std::ios::binary);
-      // ifstream ref_file(std::string(args.filename) + ".binrev.pointers", std::ios::binary);
-      for(size_t i = 0; i < patternlength; ++i) {
-        const size_t len = len_file[patternlength-i-1];
-        const size_t ref = ref_file[patternlength-i-1];
-        // size_t len;
-        // size_t ref;
-        // len_file.seekg((patternlength-i-1)*sizeof(size_t), std::ios_base::beg);
-        // ref_file.seekg((patternlength-i-1)*sizeof(size_t), std::ios_base::beg);
-        // read_int(len_file, len);
-        // read_int(ref_file, ref);
-        // DCHECK_EQ(lengths[i], len);
-        // DCHECK_EQ(refs[i], ref);
-        f_lengths << len << " ";
-        f_pointers << ref << " ";
+      // One pattern at a time, queried in chunks by all the threads
+      std::vector<size_t> pattern_lengths;
+      std::vector<size_t> pattern_pointers;
+      const std::string_view patterndesc = group.name(0);
+      const std::string_view pattern = group.sequence(0);
+      verbose("Processing pattern ", patterndesc);
+
+      std::chrono::high_resolution_clock::time_point t_pattern_start = std::chrono::high_resolution_clock::now();
+      ms.query_parallel(pattern, pattern_lengths, pattern_pointers, pool, args.chunk, &stats[0], args.pointers_only);
+      if (!args.recover.empty()) {
+        pool.parallel_for_chunks(pattern.size(), args.chunk, [&](const size_t begin, const size_t end, const size_t) {
+          ms.recover_lengths(pattern, pattern_pointers, pattern_lengths, begin, end);
+        });
+        mask_lengths(args.recover, pattern_lengths);
       }
-    f_lengths << endl;
-    f_pointers << endl;
+      std::chrono::high_resolution_clock::time_point t_pattern_end = std::chrono::high_resolution_clock::now();
+
+      verbose("Finished processing pattern ", patterndesc);
+      results.push(first_id, format_result(patterndesc, pattern_lengths, pattern_pointers));
+      verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_pattern_end - t_pattern_start).count());
     }
+    else
+    {
+      pool.parallel_for_chunks(group.size(), args.batch, [&](const size_t begin, const size_t end, const size_t thread_id) {
+        auto& batch_lengths = lengths[thread_id];
+        auto& batch_pointers = pointers[thread_id];
+        batch_lengths.resize(end - begin);
+        batch_pointers.resize(end - begin);
+
+        std::vector<std::string_view> patterns;
+        for(size_t patternid = begin; patternid < end; ++patternid) {
+          verbose("Processing pattern ", group.name(patternid));
+          patterns.push_back(group.sequence(patternid));
+
+          batch_lengths[patternid - begin].resize(patterns.back().size());
+          batch_pointers[patternid - begin].resize(patterns.back().size());
+        }
+
+        std::chrono::high_resolution_clock::time_point t_pattern_start = std::chrono::high_resolution_clock::now();
+        ms.query_batch(patterns, [&](const size_t k, const size_t i, const size_t len, const size_t ref) {
+          batch_lengths[k][i] = len;
+          batch_pointers[k][i] = ref;
+        }, &stats[thread_id], trace_file ? &traces[thread_id] : nullptr, args.pointers_only);
+        if (trace_file)
+          trace_file->append(traces[thread_id], trace_writer::block_size);
+        std::chrono::high_resolution_clock::time_point t_pattern_end = std::chrono::high_resolution_clock::now();
+
+        for(size_t patternid = begin; patternid < end; ++patternid) {
+          const std::string_view patterndesc = group.name(patternid);
+          const size_t k = patternid - begin;
+          verbose("Finished processing pattern ", patterndesc);
+
+          if (!args.recover.empty()) {
+            ms.recover_lengths(patterns[k], batch_pointers[k], batch_lengths[k]);
+            mask_lengths(args.recover, batch_lengths[k]);
+          }
+
+          results.push(first_id + patternid, format_result(patterndesc, batch_lengths[k], batch_pointers[k]));
+        }
+        verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_pattern_end - t_pattern_start).count());
+      });
+    }
+
+    first_id += group.size();
+    more = next.get();
   }
 
   f_pointers.close();
   f_lengths.close();
 
+  if (trace_file)
+  {
+    for (auto &trace : traces)
+      trace_file->append(trace);
+    verbose("Query trace written to ", args.trace);
+  }
+
+  if (!args.stats.empty())
+  {
+    write_query_stats(args.stats, stats);
+    verbose("Query statistics written to ", args.stats);
+  }
+
   t_insert_end = std::chrono::high_resolution_clock::now();
 
   verbose("Memory peak: ", malloc_count_peak());
@@ -167,6 +329,34 @@ int main(int argc, char *const argv[]) {
 
   if (args.csv)
     std::cerr << csv(args.filename.c_str(), time, space, mem_peak) << std::endl;
+}
+
+int main(int argc, char *const argv[]) {
+  Args args;
+  parseArgs(argc, argv, args);
+
+#ifdef NDEBUG
+  verbose("RELEASE build");
+#else
+  verbose("DEBUG build");
+#endif
+
+  verbose("Memory peak: ", malloc_count_peak());
+
+  uint64_t alphabet;
+  {
+    const mapped_file file(args.filename + ".phoni");
+    mapped_istream in(file);
+    alphabet = read_phoni_alphabet(in);
+  }
+
+  if (alphabet == alphabet_traits<dna_string>::tag)
+  {
+    verbose("Alphabet: ", alphabet_traits<dna_string>::name);
+    query_patterns<ms_pointers<ri::sparse_sd_vector, ms_rle_string_dna>>(args);
+  }
+  else
+    query_patterns<ms_pointers<>>(args);
 
   return 0;
 }
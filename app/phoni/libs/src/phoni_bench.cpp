@@ -0,0 +1,373 @@
+/* phoni_bench - Micro-benchmarks of the PHONI primitives
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file phoni_bench.cpp
+   \brief phoni_bench.cpp Micro-benchmarks of the PHONI primitives.
+
+   Usage: phoni_bench [benchmark options] <index> [grammar format]
+
+   The index is the basename of the files given to build_phoni: <index>.bwt.heads,
+   <index>.bwt.len, <index>.ssa, <index>.esa and <index>.slp. The SLP encodings other
+   than the one of PHONI are built from the grammar <index>.C/.R, in the given format
+   (Bigrepair, rrepair or NavarroRepair, Bigrepair by default).
+
+   The target exists only if Google Benchmark has been built in dependencies/benchmark/build,
+   and it is built only when asked for, with make phoni_bench.
+*/
+
+#include <random>
+#include <memory>
+#include <type_traits>
+
+#include <benchmark/benchmark.h>
+
+#include <common.hpp>
+
+#include <phoni.hpp>
+
+#include <PlainSlp.hpp>
+
+//! Basename of the index under test
+static std::string index_name;
+//! Format of the grammar <index>.C/.R
+static std::string grammar_format = "Bigrepair";
+
+//! Number of random inputs of each benchmark, that are cycled through
+static const size_t n_inputs = 1 << 16;
+
+using phoni_slp_t = SelfShapedSlp<var_t, DagcSd, DagcSd, SelSd>;
+using mcl_slp_t = SelfShapedSlp<var_t, DagcMcl, DagcMcl, SelMcl>;
+using plain_slp_t = PlainSlp<var_t, Fblc, Fblc>;
+
+using ms_sd_t = ms_pointers<ri::sparse_sd_vector, ms_rle_string_sd>;
+using ms_hyb_t = ms_pointers<ri::sparse_hyb_vector, ms_rle_string_hyb>;
+
+//! Fixed seed, so that every run measures the same inputs
+static std::mt19937_64 generator()
+{
+    return std::mt19937_64(0x5eed);
+}
+
+//******************************************************************************
+// The structures under test, built at their first benchmark and kept for the others
+
+template <class rle_t>
+rle_t &rle_string()
+{
+    static const std::unique_ptr<rle_t> rle = [] {
+        std::ifstream heads(index_name + ".bwt.heads");
+        std::ifstream lengths(index_name + ".bwt.len");
+        if (!heads.is_open() || !lengths.is_open())
+            error("open() file " + index_name + ".bwt.heads or .bwt.len failed");
+        return std::make_unique<rle_t>(heads, lengths);
+    }();
+    return *rle;
+}
+
+template <class ms_t>
+ms_t &index()
+{
+    static const std::unique_ptr<ms_t> ms = [] {
+        auto ms = std::make_unique<ms_t>();
+        ms->build(index_name);
+        ms->load_grammar(index_name);
+        return ms;
+    }();
+    return *ms;
+}
+
+template <class SlpT>
+SlpT *encode_slp(const NaiveSlp<var_t> &grammar, SlpT *)
+{
+    return new SlpT(grammar);
+}
+
+template <class VarVecT, class LenVecT>
+PlainSlp<var_t, VarVecT, LenVecT> *encode_slp(const NaiveSlp<var_t> &grammar, PlainSlp<var_t, VarVecT, LenVecT> *)
+{
+    NaiveSlp<var_t> binary(grammar);
+    binary.makeBinaryTree();
+    auto slp = new PlainSlp<var_t, VarVecT, LenVecT>();
+    slp->init(binary);
+    return slp;
+}
+
+//! The SLP of PHONI is loaded from <index>.slp, the others are encoded from the grammar
+template <class SlpT>
+SlpT &slp()
+{
+    static const std::unique_ptr<SlpT> slp = [] {
+        if constexpr (std::is_same<SlpT, phoni_slp_t>::value)
+        {
+            auto slp = std::make_unique<SlpT>();
+            const mapped_file file(index_name + ".slp");
+            mapped_istream fs(file);
+            slp->load(fs);
+            return slp;
+        }
+        NaiveSlp<var_t> grammar;
+        if (grammar_format == "NavarroRepair")
+            grammar.load_NavarroRepair(index_name.data());
+        else if (grammar_format == "Bigrepair" || grammar_format == "rrepair")
+            grammar.load_Bigrepair(index_name.data(), grammar_format == "rrepair");
+        else
+            error("unknown grammar format " + grammar_format);
+        return std::unique_ptr<SlpT>(encode_slp(grammar, static_cast<SlpT *>(nullptr)));
+    }();
+    return *slp;
+}
+
+//! Positions i of the BWT and characters c occurring in the text, in random order
+template <class rle_t>
+const std::vector<std::pair<ri::ulint, ri::uchar>> &positions()
+{
+    static const std::vector<std::pair<ri::ulint, ri::uchar>> inputs = [] {
+        auto &rle = rle_string<rle_t>();
+        const auto &text = index<ms_sd_t>().slp;
+        auto gen = generator();
+        std::vector<std::pair<ri::ulint, ri::uchar>> inputs(n_inputs);
+        for (auto &input : inputs)
+            input = {gen() % rle.size(), text.charAt(gen() % text.getLen())};
+        return inputs;
+    }();
+    return inputs;
+}
+
+//! Pairs of text positions with an LCE of at least 2^b, for each b
+/*!
+ * The pairs are the suffixes at the ends of consecutive BWT runs, that are
+ * adjacent in the suffix array and so share long prefixes: the pairs the
+ * queries compute LCEs of.
+ */
+const std::vector<std::vector<std::pair<size_t, size_t>>> &lce_pairs()
+{
+    static const std::vector<std::vector<std::pair<size_t, size_t>>> pairs = [] {
+        auto &ms = index<ms_sd_t>();
+        const size_t r = ms.samples_start.size();
+        const size_t n = ms.slp.getLen();
+        int_vector<> samples_last;
+        ms.read_samples(index_name + ".esa", r, bitsize(uint64_t(n + 1)), samples_last);
+
+        std::vector<std::vector<std::pair<size_t, size_t>>> pairs(64);
+        auto gen = generator();
+        for (size_t k = 0; k < std::min(r, n_inputs); ++k)
+        {
+            const size_t j = 1 + gen() % (r - 1);
+            const size_t p1 = samples_last[j - 1] + 1;
+            const size_t p2 = ms.samples_start[j] + 1;
+            if (p1 >= n || p2 >= n || p1 == p2)
+                continue;
+            const size_t lce = lceToR(ms.slp, p1, p2);
+            for (size_t b = 0; lce >= (size_t(1) << b); ++b)
+                pairs[b].emplace_back(p1, p2);
+        }
+        return pairs;
+    }();
+    return pairs;
+}
+
+//! Substrings of the text with about 1% of their characters replaced
+const std::vector<std::string> &patterns()
+{
+    static const std::vector<std::string> patterns = [] {
+        const auto &text = index<ms_sd_t>().slp;
+        const size_t m = std::min<size_t>(1000, text.getLen());
+        const char alphabet[] = "ACGT";
+        auto gen = generator();
+        std::vector<std::string> patterns(64);
+        for (auto &pattern : patterns)
+        {
+            pattern.resize(m);
+            text.expandSubstr(gen() % (text.getLen() - m + 1), m, &pattern[0]);
+            for (auto &c : pattern)
+                if (gen() % 100 == 0)
+                    c = alphabet[gen() % 4];
+        }
+        return patterns;
+    }();
+    return patterns;
+}
+
+//******************************************************************************
+// Benchmarks
+
+template <class rle_t>
+static void BM_Rank(benchmark::State &state)
+{
+    auto &rle = rle_string<rle_t>();
+    const auto &inputs = positions<rle_t>();
+    size_t k = 0;
+    for (auto _ : state)
+    {
+        const auto &input = inputs[k++ % n_inputs];
+        benchmark::DoNotOptimize(rle.rank(input.first, input.second));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class rle_t>
+static void BM_Select(benchmark::State &state)
+{
+    auto &rle = rle_string<rle_t>();
+    std::vector<std::pair<ri::ulint, ri::uchar>> inputs;
+    for (const auto &input : positions<rle_t>())
+    {
+        const ri::ulint rank = rle.rank(input.first, input.second);
+        if (rank > 0)
+            inputs.emplace_back(rank - 1, input.second);
+    }
+    size_t k = 0;
+    for (auto _ : state)
+    {
+        const auto &input = inputs[k++ % inputs.size()];
+        benchmark::DoNotOptimize(rle.select(input.first, input.second));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class rle_t>
+static void BM_RunOfPosition(benchmark::State &state)
+{
+    auto &rle = rle_string<rle_t>();
+    const auto &inputs = positions<rle_t>();
+    size_t k = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(rle.run_of_position(inputs[k++ % n_inputs].first));
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class ms_t>
+static void BM_LF(benchmark::State &state)
+{
+    auto &ms = index<ms_t>();
+    const auto &inputs = positions<ms_rle_string_sd>();
+    size_t k = 0;
+    for (auto _ : state)
+    {
+        const auto &input = inputs[k++ % n_inputs];
+        benchmark::DoNotOptimize(ms.LF(input.first, input.second));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//! LCEs of exactly state.range(0) characters: pairs sharing at least as many, with it as upper bound
+template <class SlpT>
+static void BM_LceToRBounded(benchmark::State &state)
+{
+    const size_t len = state.range(0);
+    auto &text = slp<SlpT>();
+    const auto &pairs = lce_pairs()[bitsize(uint64_t(len)) - 1];
+    if (pairs.empty())
+    {
+        state.SkipWithError("no pairs of positions with such an LCE in the text");
+        return;
+    }
+    size_t k = 0;
+    for (auto _ : state)
+    {
+        const auto &p = pairs[k++ % pairs.size()];
+        benchmark::DoNotOptimize(lceToRBounded(text, p.first, p.second, len));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::to_string(pairs.size()) + " pairs");
+}
+
+template <class SlpT>
+static void BM_CharAt(benchmark::State &state)
+{
+    auto &text = slp<SlpT>();
+    std::vector<size_t> inputs(n_inputs);
+    auto gen = generator();
+    for (auto &i : inputs)
+        i = gen() % text.getLen();
+    size_t k = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(text.charAt(inputs[k++ % n_inputs]));
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class SlpT>
+static void BM_ExpandSubstr(benchmark::State &state)
+{
+    auto &text = slp<SlpT>();
+    const size_t len = std::min<size_t>(state.range(0), text.getLen());
+    std::vector<size_t> inputs(n_inputs);
+    auto gen = generator();
+    for (auto &i : inputs)
+        i = gen() % (text.getLen() - len + 1);
+    std::vector<char> buffer(len);
+    size_t k = 0;
+    for (auto _ : state)
+    {
+        text.expandSubstr(inputs[k++ % n_inputs], len, buffer.data());
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+
+//! Matching statistics of the patterns, reported per base
+template <class ms_t>
+static void BM_Query(benchmark::State &state)
+{
+    auto &ms = index<ms_t>();
+    const auto &inputs = patterns();
+    size_t k = 0, bases = 0;
+    for (auto _ : state)
+    {
+        const auto &pattern = inputs[k++ % inputs.size()];
+        size_t sum = 0;
+        ms.query(pattern, [&](const size_t, const size_t len, const size_t ref) { sum += len + ref; });
+        benchmark::DoNotOptimize(sum);
+        bases += pattern.size();
+    }
+    state.SetItemsProcessed(bases);
+}
+
+BENCHMARK_TEMPLATE(BM_Rank, ms_rle_string_sd);
+BENCHMARK_TEMPLATE(BM_Rank, ms_rle_string_hyb);
+BENCHMARK_TEMPLATE(BM_Select, ms_rle_string_sd);
+BENCHMARK_TEMPLATE(BM_Select, ms_rle_string_hyb);
+BENCHMARK_TEMPLATE(BM_RunOfPosition, ms_rle_string_sd);
+BENCHMARK_TEMPLATE(BM_RunOfPosition, ms_rle_string_hyb);
+BENCHMARK_TEMPLATE(BM_LF, ms_sd_t);
+BENCHMARK_TEMPLATE(BM_LF, ms_hyb_t);
+
+BENCHMARK_TEMPLATE(BM_LceToRBounded, phoni_slp_t)->RangeMultiplier(4)->Range(4, 1 << 14);
+BENCHMARK_TEMPLATE(BM_LceToRBounded, mcl_slp_t)->RangeMultiplier(4)->Range(4, 1 << 14);
+BENCHMARK_TEMPLATE(BM_LceToRBounded, plain_slp_t)->RangeMultiplier(4)->Range(4, 1 << 14);
+BENCHMARK_TEMPLATE(BM_CharAt, phoni_slp_t);
+BENCHMARK_TEMPLATE(BM_CharAt, mcl_slp_t);
+BENCHMARK_TEMPLATE(BM_CharAt, plain_slp_t);
+BENCHMARK_TEMPLATE(BM_ExpandSubstr, phoni_slp_t)->RangeMultiplier(8)->Range(8, 1 << 12);
+BENCHMARK_TEMPLATE(BM_ExpandSubstr, mcl_slp_t)->RangeMultiplier(8)->Range(8, 1 << 12);
+BENCHMARK_TEMPLATE(BM_ExpandSubstr, plain_slp_t)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+BENCHMARK_TEMPLATE(BM_Query, ms_sd_t);
+BENCHMARK_TEMPLATE(BM_Query, ms_hyb_t);
+
+int main(int argc, char *argv[])
+{
+    benchmark::Initialize(&argc, argv);
+    if (argc < 2 || argc > 3)
+        error("usage: ", argv[0], " [benchmark options] <index> [Bigrepair | rrepair | NavarroRepair]");
+    index_name = argv[1];
+    if (argc == 3)
+        grammar_format = argv[2];
+
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,191 @@
+/* phoni_replay - Replays the LCE or the LF calls of a query trace
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file phoni_replay.cpp
+   \brief phoni_replay.cpp Replays the LCE or the LF calls of a query trace.
+
+   The trace is recorded by phoni -T. The LCE calls are replayed with
+   lceToRBounded on any SLP encoding of the text written by SlpEncBuild, and
+   the LF and select calls on any run-length encoding of the BWT built from
+   the files of build_phoni. Each result is checked against the trace.
+*/
+
+#include <iostream>
+#include <map>
+
+#define VERBOSE
+
+#include <common.hpp>
+
+#include <phoni.hpp>
+
+#include <query_trace.hpp>
+
+#include <malloc_count.h>
+
+using timer = std::chrono::high_resolution_clock;
+
+static void report(const std::string &calls, const size_t n, const size_t wrong, const double seconds)
+{
+    std::cout << calls << " calls: " << n << "\n"
+              << calls << " wrong results: " << wrong << "\n"
+              << calls << " time per call (ns): " << (n ? seconds * 1e9 / n : 0) << std::endl;
+}
+
+template <class SlpT>
+size_t replay_lce(const std::string &grammar, const std::vector<trace_event> &events)
+{
+    verbose("Loading the grammar ", grammar);
+    SlpT slp;
+    {
+        const mapped_file file(grammar);
+        mapped_istream fs(file);
+        slp.load(fs);
+    }
+
+    verbose("Replaying the LCE calls");
+    size_t wrong = 0;
+    const auto t_start = timer::now();
+    for (const auto &e : events)
+    {
+        const uint64_t len = lceToRBounded(slp, e.a, e.b, e.c);
+        wrong += std::min(len, e.c) != std::min(e.result, e.c);
+    }
+    const double seconds = std::chrono::duration<double, std::ratio<1>>(timer::now() - t_start).count();
+    report("LCE", events.size(), wrong, seconds);
+    return wrong;
+}
+
+template <class rle_t>
+size_t replay_lf(const std::string &index, const std::vector<trace_event> &lfs, const std::vector<trace_event> &selects)
+{
+    verbose("Building the run-length encoded BWT");
+    std::ifstream heads(index + ".bwt.heads");
+    std::ifstream lengths(index + ".bwt.len");
+    if (!heads.is_open() || !lengths.is_open())
+        error("open() file " + index + ".bwt.heads or .bwt.len failed");
+    rle_t bwt(heads, lengths);
+    std::vector<ri::ulint> F(256, 0);
+    for (size_t c = 1; c < 256; ++c)
+        F[c] = F[c - 1] + bwt.rank(bwt.size(), c - 1);
+
+    verbose("Replaying the LF calls");
+    size_t wrong = 0;
+    auto t_start = timer::now();
+    for (const auto &e : lfs)
+        wrong += F[e.b] + bwt.rank(e.a, e.b) != e.result;
+    double seconds = std::chrono::duration<double, std::ratio<1>>(timer::now() - t_start).count();
+    report("LF", lfs.size(), wrong, seconds);
+
+    verbose("Replaying the select calls");
+    size_t wrong_selects = 0;
+    t_start = timer::now();
+    for (const auto &e : selects)
+        wrong_selects += bwt.run_of_position(bwt.select(e.a, e.b)) != e.result;
+    seconds = std::chrono::duration<double, std::ratio<1>>(timer::now() - t_start).count();
+    report("select", selects.size(), wrong_selects, seconds);
+
+    return wrong + wrong_selects;
+}
+
+int main(int argc, char *const argv[])
+{
+    using lce_funcs_type = std::map<std::string, size_t (*)(const std::string &, const std::vector<trace_event> &)>;
+    lce_funcs_type lce_funcs;
+    lce_funcs.insert(make_pair("PlainSlp_FblcFblc", replay_lce<PlainSlp<var_t, Fblc, Fblc>>));
+    lce_funcs.insert(make_pair("PlainSlp_IblcFblc", replay_lce<PlainSlp<var_t, IncBitLenCode, Fblc>>));
+    lce_funcs.insert(make_pair("PlainSlp_32Fblc", replay_lce<PlainSlp<var_t, FixedBitLenCode<32>, Fblc>>));
+    lce_funcs.insert(make_pair("SelfShapedSlp_SdSd_Sd", replay_lce<SelfShapedSlp<var_t, DagcSd, DagcSd, SelSd>>));
+    lce_funcs.insert(make_pair("SelfShapedSlp_SdSd_Mcl", replay_lce<SelfShapedSlp<var_t, DagcSd, DagcSd, SelMcl>>));
+
+    using lf_funcs_type = std::map<std::string, size_t (*)(const std::string &, const std::vector<trace_event> &, const std::vector<trace_event> &)>;
+    lf_funcs_type lf_funcs;
+    lf_funcs.insert(make_pair("sd", replay_lf<ms_rle_string_sd>));
+    lf_funcs.insert(make_pair("hyb", replay_lf<ms_rle_string_hyb>));
+    lf_funcs.insert(make_pair("dna", replay_lf<ms_rle_string_dna>));
+
+    std::string encodings, variants;
+    for (const auto &f : lce_funcs)
+        encodings += f.first + ". ";
+    for (const auto &f : lf_funcs)
+        variants += f.first + ". ";
+
+    std::string usage("usage: " + std::string(argv[0]) + " infile trace [-l lf] [-e encoding] [-g grammar] [-r rle]\n\n" +
+                      "Replays the LCE calls of trace, recorded by phoni -T trace, or its LF and select calls, and checks their results.\n" +
+                      "      lf: [boolean] - replay the LF and select calls instead of the LCE calls. (def. false)\n" +
+                      "encoding: [string]  - encoding of the grammar: " + encodings + "(def. SelfShapedSlp_SdSd_Sd)\n" +
+                      " grammar: [string]  - grammar written by SlpEncBuild with the given encoding. (def. infile.slp)\n" +
+                      "     rle: [string]  - run-length encoding of the BWT, built from infile.bwt.heads and infile.bwt.len: " + variants + "(def. sd)\n");
+
+    bool lf = false;
+    std::string encoding = "SelfShapedSlp_SdSd_Sd";
+    std::string grammar = "";
+    std::string rle = "sd";
+    int c;
+    while ((c = getopt(argc, argv, "le:g:r:h")) != -1)
+    {
+        switch (c)
+        {
+        case 'l':
+            lf = true;
+            break;
+        case 'e':
+            encoding.assign(optarg);
+            break;
+        case 'g':
+            grammar.assign(optarg);
+            break;
+        case 'r':
+            rle.assign(optarg);
+            break;
+        case 'h':
+            error(usage);
+        default:
+            error("Unknown option.\n", usage);
+        }
+    }
+    if (argc != optind + 2)
+        error("Invalid number of arguments\n", usage);
+    const std::string filename = argv[optind];
+    const std::string tracename = argv[optind + 1];
+    if (grammar.empty())
+        grammar = filename + ".slp";
+
+    size_t wrong;
+    if (lf)
+    {
+        const auto f = lf_funcs.find(rle);
+        if (f == lf_funcs.end())
+            error("unknown run-length encoding " + rle + "\n", usage);
+        trace_reader reader(tracename);
+        const auto lfs = reader.events(trace_event::lf_event);
+        const auto selects = trace_reader(tracename).events(trace_event::select_event);
+        wrong = f->second(filename, lfs, selects);
+    }
+    else
+    {
+        const auto f = lce_funcs.find(encoding);
+        if (f == lce_funcs.end())
+            error("unknown encoding " + encoding + "\n", usage);
+        wrong = f->second(grammar, trace_reader(tracename).events(trace_event::lce_event));
+    }
+
+    verbose("Memory peak: ", malloc_count_peak());
+    if (wrong > 0)
+        error(wrong, " replayed results differ from the trace");
+    return 0;
+}
@@ -0,0 +1,145 @@
+/* phoni_scaling - Builds and queries PHONI on synthetic collections of growing size
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file phoni_scaling.cpp
+   \brief phoni_scaling.cpp Builds and queries PHONI on synthetic collections of growing size.
+
+   For each number of copies, generates the collection and its reads with
+   gen_pangenome's generator, builds the inputs of build_phoni in-process, then
+   builds the index as build_phoni does and queries the reads as phoni does.
+   Prints one tab-separated row per collection on stdout. The files of each
+   collection are left in prefix.<copies>.*, so that the tools can be rerun on them.
+*/
+
+#include <iostream>
+#include <sstream>
+
+#include <common.hpp>
+
+#include <phoni.hpp>
+
+#include <synthetic_pangenome.hpp>
+
+#include <malloc_count.h>
+
+using timer = std::chrono::high_resolution_clock;
+
+static double seconds_since(const timer::time_point &start)
+{
+    return std::chrono::duration<double, std::ratio<1>>(timer::now() - start).count();
+}
+
+static size_t file_size(const std::string &filename)
+{
+    struct stat filestat;
+    if (stat(filename.c_str(), &filestat) != 0)
+        error("stat() file " + filename + " failed");
+    return filestat.st_size;
+}
+
+int main(int argc, char *const argv[])
+{
+    std::string usage("usage: " + std::string(argv[0]) + " prefix [-N sizes] " + pangenome_usage + "\n\n" +
+                      "Generates collections with the given numbers of copies of the base sequence in prefix.<copies>,\n" +
+                      "builds and queries their PHONI indexes, and prints the build time, the memory peaks,\n" +
+                      "the index size and the query time per base of each.\n" +
+                      "      sizes: [list]    - comma-separated numbers of copies. (def. 1,2,4,8,16,32)\n" +
+                      pangenome_options_usage);
+
+    pangenome_params params;
+    std::vector<size_t> sizes = {1, 2, 4, 8, 16, 32};
+    int c;
+    while ((c = getopt(argc, argv, (pangenome_options + "N:h").c_str())) != -1)
+    {
+        if (c == 'N')
+        {
+            sizes.clear();
+            std::stringstream list(optarg);
+            std::string size;
+            while (std::getline(list, size, ','))
+                sizes.push_back(std::stoull(size));
+        }
+        else if (c == 'h')
+            error(usage);
+        else if (!parse_pangenome_option(c, optarg, params))
+            error("Unknown option.\n", usage);
+    }
+    if (argc != optind + 1)
+        error("Invalid number of arguments\n", usage);
+    const std::string prefix = argv[optind];
+
+    std::cout << "copies\tn\tr\tn/r\trules\tinputs_s\tbuild_s\tbuild_peak_bytes\tindex_bytes\tquery_peak_bytes\tns_per_base\tmean_ms" << std::endl;
+    for (const size_t copies : sizes)
+    {
+        params.copies = copies;
+        const std::string basename = prefix + "." + std::to_string(copies);
+
+        pangenome_generator generator(params);
+        const auto genomes = generator.genomes();
+        const auto reads = generator.reads(genomes);
+        std::string text;
+        for (const auto &genome : genomes)
+            text += genome.second;
+        write_patterns(basename + ".reads", reads);
+
+        // The inputs built by the prefix-free parsing and RePair pipeline
+        auto t_start = timer::now();
+        const size_t r = build_rlbwt(text, basename);
+        const size_t rules = build_slp(text, basename);
+        const double inputs_time = seconds_since(t_start);
+
+        // build_phoni, with the peak above the memory holding the collection
+        size_t baseline = malloc_count_current();
+        malloc_count_reset_peak();
+        t_start = timer::now();
+        {
+            ms_pointers<> ms;
+            ms.build(basename);
+            std::ofstream out(basename + ".phoni", std::ios::binary);
+            ms.serialize(out);
+        }
+        const double build_time = seconds_since(t_start);
+        const size_t build_peak = malloc_count_peak() - baseline;
+        const size_t index_size = file_size(basename + ".phoni") + file_size(basename + ".slp");
+
+        // phoni, with the peak including the loading of the index
+        baseline = malloc_count_current();
+        malloc_count_reset_peak();
+        size_t bases = 0, ms_sum = 0;
+        double query_time;
+        {
+            ms_pointers<> ms;
+            ms.load_mapped(basename);
+            t_start = timer::now();
+            for (const auto &read : reads)
+            {
+                ms.query(std::string_view(read.second), [&](const size_t, const size_t len, const size_t) { ms_sum += len; });
+                bases += read.second.size();
+            }
+            query_time = seconds_since(t_start);
+        }
+        const size_t query_peak = malloc_count_peak() - baseline;
+
+        const size_t n = text.size() + 1;
+        std::cout << copies << "\t" << n << "\t" << r << "\t" << double(n) / r << "\t" << rules << "\t"
+                  << inputs_time << "\t" << build_time << "\t" << build_peak << "\t" << index_size << "\t"
+                  << query_peak << "\t" << (bases ? query_time * 1e9 / bases : 0) << "\t"
+                  << (bases ? double(ms_sum) / bases : 0) << std::endl;
+    }
+
+    return 0;
+}
@@ -31,6 +31,7 @@
 #include <malloc_count.h>
 
 #include <SelfShapedSlp.hpp>
+#include <SlpIterator.hpp>
 #include <DirectAccessibleGammaCode.hpp>
 #include <SelectType.hpp>
 
@@ -90,6 +91,19 @@ int main(int argc, char *const argv[])
   verbose("Memory peak: ", malloc_count_peak());
   verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
 
+  verbose("Checking if the iterator equals");
+  t_insert_start = std::chrono::high_resolution_clock::now();
+
+  SlpIterator<decltype(ra)> it(ra);
+  for(size_t i = 0; i < n; ++i, ++it)
+    if(*it != text[i])
+      error("Different character in position ", i, " iterator: ", *it, " text: ", text[i]);
+
+  t_insert_end = std::chrono::high_resolution_clock::now();
+
+  verbose("Memory peak: ", malloc_count_peak());
+  verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+
   auto mem_peak = malloc_count_peak();
   verbose("Memory peak: ", malloc_count_peak());
 
@@ -0,0 +1,138 @@
+/* thresholds_test - Test the thresholds computed by build_phoni against the suffix and LCP arrays
+    Copyright (C) 2026 The PHONI contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see http://www.gnu.org/licenses/ .
+*/
+/*!
+   \file thresholds_test.cpp
+   \brief thresholds_test.cpp Test the thresholds computed by build_phoni against the suffix and LCP arrays.
+*/
+
+#include <iostream>
+
+#define VERBOSE
+
+#include <common.hpp>
+
+#include <sdsl/io.hpp>
+
+#include <phoni.hpp>
+
+#include <malloc_count.h>
+
+#include <divsufsort64.h>
+
+
+int main(int argc, char *const argv[])
+{
+  Args args;
+  parseArgs(argc, argv, args);
+
+  // Computing the thresholds as build_phoni -g does
+  verbose("Computing the thresholds from the grammar");
+  std::chrono::high_resolution_clock::time_point t_insert_start = std::chrono::high_resolution_clock::now();
+
+  ms_pointers<> ms;
+  ms.build(args.filename);
+  ms.load_grammar(args.filename);
+  ms.build_thresholds(args.filename, args.th);
+
+  std::chrono::high_resolution_clock::time_point t_insert_end = std::chrono::high_resolution_clock::now();
+
+  verbose("Memory peak: ", malloc_count_peak());
+  verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+
+  // The text is the expansion of the grammar followed by the terminator, as in the BWT
+  verbose("Computing the suffix and LCP arrays");
+  t_insert_start = std::chrono::high_resolution_clock::now();
+
+  const size_t n = ms.slp.getLen() + 1;
+  std::vector<uint8_t> text(n, 0);
+  ms.slp.expandSubstr(0, n - 1, (char *)text.data());
+
+  std::vector<saidx64_t> sa(n);
+  if (divsufsort64(text.data(), sa.data(), n) != 0)
+    error("divsufsort64 failed");
+
+  // Kasai et al.: lcp[i] is the LCP of the suffixes at i - 1 and i, that stops at the terminator
+  std::vector<uint64_t> lcp(n, 0);
+  {
+    std::vector<saidx64_t> isa(n);
+    for (size_t i = 0; i < n; ++i)
+      isa[sa[i]] = i;
+    size_t h = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (isa[i] == 0)
+      {
+        h = 0;
+        continue;
+      }
+      const size_t j = sa[isa[i] - 1];
+      while (i + h < n - 1 && j + h < n - 1 && text[i + h] == text[j + h])
+        ++h;
+      lcp[isa[i]] = h;
+      if (h > 0)
+        --h;
+    }
+  }
+
+  t_insert_end = std::chrono::high_resolution_clock::now();
+
+  verbose("Memory peak: ", malloc_count_peak());
+  verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+
+  // The threshold of a run is the first position of minimum LCP between the last c of the
+  // preceding run of c and the head of the run, and 0 for the first run of c
+  verbose("Checking if equals");
+  t_insert_start = std::chrono::high_resolution_clock::now();
+
+  auto bwt = [&](const size_t i) {
+    const uint8_t c = text[(sa[i] + n - 1) % n];
+    return c <= TERMINATOR ? TERMINATOR : c;
+  };
+  std::vector<size_t> last_of(256, n); // last position of each character so far, n if none
+  size_t run = 0;
+  for (size_t start = 0, i = 0; i < n; ++i)
+  {
+    if (i + 1 < n && bwt(i + 1) == bwt(i))
+      continue;
+    const uint8_t c = bwt(i);
+    size_t threshold = 0;
+    if (last_of[c] < n)
+    {
+      threshold = last_of[c] + 1;
+      for (size_t j = threshold + 1; j <= start; ++j)
+        if (lcp[j] < lcp[threshold])
+          threshold = j;
+    }
+    if (run >= ms.thresholds.size())
+      error("The index has ", ms.thresholds.size(), " runs, fewer than the text");
+    if (ms.thresholds[run] != threshold)
+      error("Different threshold of run ", run, " index: ", ms.thresholds[run], " arrays: ", threshold);
+    last_of[c] = i;
+    start = i + 1;
+    ++run;
+  }
+  if (run != ms.thresholds.size())
+    error("The index has ", ms.thresholds.size(), " runs, the text ", run);
+
+  t_insert_end = std::chrono::high_resolution_clock::now();
+
+  verbose("Runs checked: ", run);
+  verbose("Memory peak: ", malloc_count_peak());
+  verbose("Elapsed time (s): ", std::chrono::duration<double, std::ratio<1>>(t_insert_end - t_insert_start).count());
+
+  return 0;
+}